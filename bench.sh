@@ -0,0 +1,203 @@
+#!/bin/bash
+
+# Benchmarks the solver on all scenarios with flight data.
+#
+# Each scenario is run BENCH_RUNS times for each thread count in BENCH_THREADS.
+# The wall time of the whole process and the phase timings written by "-stats"
+# are recorded. The results are written to BENCH_DIR:
+#
+#   raw.csv      One line per run and phase.
+#   summary.csv  Median, 10th and 90th percentile, minimum and maximum per
+#                scenario, binary, thread count and phase, plus the speedup and
+#                efficiency of the median against the smallest thread count.
+#   summary.json The same as JSON.
+#
+# BENCH_SIZES may list numbers of flights per day. For each of them, a synthetic
+# data set (30 days, see tools/generate_flights) is generated and benchmarked
+# as scenario "generated_<n>", so that the scaling by data size can be seen.
+#
+# If BENCH_REF names a binary that can be executed on this machine (e.g. the
+# reference binary "run-orig"), it is benchmarked as well (wall time only),
+# so that regressions can be spotted. Otherwise it is skipped.
+
+RUNS=${BENCH_RUNS:-5}
+THREADS=${BENCH_THREADS:-}
+SCENARIOS=${BENCH_SCENARIOS:-}
+SIZES=${BENCH_SIZES:-}
+OUT=${BENCH_DIR:-bench_results}
+REF=${BENCH_REF:-./run-orig}
+
+D=$(pwd)
+
+if [ -z "$THREADS" ] ; then
+	N=$(getconf _NPROCESSORS_ONLN 2> /dev/null || echo 4)
+	T=1
+	while [ $T -lt $N ] ; do
+		THREADS="$THREADS $T"
+		T=$((T * 2))
+	done
+	THREADS="$THREADS $N"
+fi
+
+if [ -z "$SCENARIOS" ] ; then
+	for S in scenarios/scenario* ; do
+		if [ -f $S/flights.txt ] ; then
+			SCENARIOS="$SCENARIOS $(basename $S)"
+		fi
+	done
+fi
+
+# Scenario directories.
+DIRS=""
+for S in $SCENARIOS ; do
+	DIRS="$DIRS $D/scenarios/$S"
+done
+
+# Tests if a binary can be executed on this machine (the bundled reference
+# binary is a Mach-O executable, which does not run on Linux).
+function runnable()
+{
+	if [ ! -x "$1" ] ; then
+		return 1
+	fi
+
+	MAGIC=$(head -c 4 "$1" | od -An -tx1 | tr -d ' \n')
+	if [ "$(uname)" = "Darwin" ] ; then
+		[ "$MAGIC" = "cffaedfe" -o "$MAGIC" = "cefaedfe" ]
+	else
+		[ "$MAGIC" = "7f454c46" ]
+	fi
+}
+
+BINARIES="run"
+if runnable "$REF" ; then
+	BINARIES="run $(basename $REF)"
+else
+	echo "Reference binary $REF cannot be run on this machine, skipping it."
+fi
+
+mkdir -p $OUT
+OUT=$(cd $OUT && pwd)
+
+for N in $SIZES ; do
+	echo "Generating data set with $N flights per day ..."
+	if ! tools/generate_flights -out $OUT/generated_$N -flights_per_day $N ; then
+		exit 1
+	fi
+	DIRS="$DIRS $OUT/generated_$N"
+done
+RAW=$OUT/raw.csv
+echo "scenario,binary,threads,run,correct,phase,seconds" > $RAW
+
+for DIR in $DIRS ; do
+	S=$(basename $DIR)
+	cd $DIR
+
+	# The command line of the scenario, without the thread count and shell timing.
+	ARGS=$(grep -o '\.\./\.\./run.*' script.sh | sed -e 's/^\.\.\/\.\.\/run//' \
+		-e 's/-nb_threads [0-9]*//')
+
+	for B in $BINARIES ; do
+		for T in $THREADS ; do
+			for R in $(seq 1 $RUNS) ; do
+				printf "%-12s %-10s threads %3d run %2d ... " $S $B $T $R
+
+				rm -f work_hard.txt play_hard.txt stats.json
+				STATS=""
+				if [ "$B" = "run" ] ; then
+					STATS="-stats stats.json"
+				fi
+
+				START=$(date +%s.%N)
+				eval "$D/$B -nb_threads $T $STATS $ARGS" > /dev/null 2>&1
+				EXIT=$?
+				END=$(date +%s.%N)
+
+				CORRECT=1
+				if [ $EXIT -ne 0 ] ; then
+					CORRECT=0
+				elif [ -f work_hard_ref.txt ] ; then
+					cmp -s work_hard.txt work_hard_ref.txt || CORRECT=0
+					cmp -s play_hard.txt play_hard_ref.txt || CORRECT=0
+				fi
+
+				WALL=$(echo "$START $END" | awk '{ printf "%.6f", $2 - $1 }')
+				echo "$S,$B,$T,$R,$CORRECT,wall,$WALL" >> $RAW
+
+				# Phase totals are the lines between "phase_totals" and the closing brace.
+				if [ -f stats.json ] ; then
+					awk -v prefix="$S,$B,$T,$R,$CORRECT" '
+						/"phase_totals"/ { p = 1; next }
+						p && /}/ { p = 0 }
+						p { gsub(/[",:]/, ""); print prefix "," $1 "," $2 }
+					' stats.json >> $RAW
+				fi
+
+				if [ $CORRECT -eq 1 ] ; then
+					echo "$WALL s"
+				else
+					echo "$WALL s (WRONG RESULT)"
+				fi
+			done
+		done
+	done
+
+	rm -f work_hard.txt play_hard.txt stats.json
+done
+
+cd $D
+
+# Percentiles use the nearest rank of the sorted values. The speedup of a phase
+# relates its median to the median at the smallest thread count.
+tail -n +2 $RAW | sort -t, -k1,1 -k2,2 -k6,6 -k3,3n -k7,7g | awk -F, '
+	function percentile(p,    i)
+	{
+		i = int(p * n)
+		if (i < p * n) i++
+		return v[i < 1 ? 1 : i]
+	}
+
+	function flush()
+	{
+		if (n == 0) return
+		median = percentile(0.5)
+		p10 = percentile(0.1)
+		p90 = percentile(0.9)
+		if (!(key in base)) { base[key] = median; base_threads[key] = threads }
+		speedup = median > 0 ? base[key] / median : 0
+		efficiency = speedup * base_threads[key] / threads
+		printf "%s,%s,%d,%s,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%.3f,%d\n", scenario, binary,
+				threads, phase, n, median, p10, p90, v[1], v[n], speedup, efficiency,
+				wrong > csv
+		printf "%s    {\"scenario\": \"%s\", \"binary\": \"%s\", \"threads\": %d, " \
+				"\"phase\": \"%s\", \"runs\": %d, \"median\": %.6f, \"p10\": %.6f, " \
+				"\"p90\": %.6f, \"min\": %.6f, \"max\": %.6f, \"speedup\": %.3f, " \
+				"\"efficiency\": %.3f, \"wrong_results\": %d}", (entries++ ? ",\n" : ""),
+				scenario, binary, threads, phase, n, median, p10, p90, v[1], v[n], speedup,
+				efficiency, wrong > json
+		n = 0
+		wrong = 0
+	}
+
+	BEGIN {
+		csv = "'$OUT'/summary.csv"
+		json = "'$OUT'/summary.json"
+		print "scenario,binary,threads,phase,runs,median,p10,p90,min,max,speedup,efficiency,wrong_results" > csv
+		printf "{\n  \"results\": [\n" > json
+	}
+
+	{
+		if ($1 != scenario || $2 != binary || $3 != threads || $6 != phase) flush()
+		scenario = $1; binary = $2; threads = $3; phase = $6
+		key = scenario "," binary "," phase
+		v[++n] = $7
+		if ($5 == 0) wrong++
+	}
+
+	END {
+		flush()
+		printf "\n  ]\n}\n" > json
+	}
+'
+
+echo "Results written to $OUT/raw.csv, $OUT/summary.csv and $OUT/summary.json."
@@ -7,10 +7,12 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <utility>
 #include <time.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "types.h"
 #include "methods.h"
@@ -19,13 +21,24 @@
 #include "tbb/parallel_for.h"
 #include "tbb/parallel_reduce.h"
 #include "tbb/tick_count.h"
-#include "tbb/mutex.h"
+#include "tbb/spin_mutex.h"
 #include "tbb/concurrent_hash_map.h"
-#include "tbb/task_scheduler_init.h"
-#include "tbb/parallel_do.h"
+#include "tbb/global_control.h"
+#include "tbb/info.h"
+#include "tbb/task_group.h"
+#include "tbb/task_arena.h"
+#include "tbb/flow_graph.h"
 
 #include "oma/loop_bodies.h"
 #include "oma/tasks.h"
+#include "oma/connection_scan.h"
+#include "oma/route_cache.h"
+#include "oma/route_store.h"
+#include "oma/allocation_counter.h"
+#include "oma/stats.h"
+#include "oma/search_profile.h"
+#include "oma/tracer.h"
+#include "oma/numa.h"
 
 using namespace std;
 using namespace tbb;
@@ -34,161 +47,248 @@ using namespace oma;
 concurrent_hash_map<string, Location> *location_map;
 concurrent_hash_map<string, bool> alliance_map;
 concurrent_hash_map<int, time_t> times;
+ConnectionScan *connection_scan = NULL;
+RouteCache *route_cache = NULL;
+
+/// Creates a flow graph node that computes a partial route.
+/** The node is connected to the graph's start node and stored in the node list, so
+ *  that it can be destroyed later. The task is run in the arena of a NUMA node and
+ *  needs to read the flight graph of the same node.
+ *
+ *  @param g     The flow graph.
+ *  @param start The graph's start node.
+ *  @param nodes List of all nodes of the graph.
+ *  @param task  The "find path" task that is run by the node.
+ *  @param numa  The NUMA node on which the task is run.
+ *  @return      The new node. */
+static GraphNode *find_path_node(flow::graph &g, flow::broadcast_node<flow::continue_msg> &start,
+		vector<GraphNode*> &nodes, const FindPathTask &task, const NumaNode &numa)
+{
+	GraphNode *node = new GraphNode(g, ArenaNodeBody<FindPathTask>(task, numa.arena));
+	flow::make_edge(start, *node);
+	nodes.push_back(node);
+
+	return node;
+}
 
 /// Solves BOTH the "Work Hard" AND the "Play Hard" problem.
 /** This function solves both the "work hard" AND the "play hard" problem.
- *  It works in two phases:
+ *  All steps are organized as nodes of a flow graph:
  *
- *  1. In the first phase, all partial routes (i.e. all intermediary routes
- *     with just one origin and destination -- e.g "home to vacation", "home to
- *     conference", etc). All these partial routes are computed in parallel
- *     using task parallelism.
+ *  1. All partial routes (i.e. all intermediary routes with just one origin
+ *     and destination -- e.g "home to vacation", "home to conference", etc)
+ *     are computed by one node each. These nodes do not depend on each other
+ *     and are all started immediately.
  *
  *     Especially the "conference to home" and "home to conference" routes are
  *     needed to solve both the "work hard" and "play hard" problems. However,
  *     since these routes are completely independent from any vacation target,
- *     they need to be computed ONLY ONCE.
+ *     they need to be computed ONLY ONCE. The routes from and to the vacation
+ *     destinations are computed by one search for all vacation destinations
+ *     each (forward from home and conference, backward from home and
+ *     conference).
+ *
+ *  2. The partial routes are merged into possible solutions for the "work hard"
+ *     and each of the "play hard" problems. Then the cheapest of each set of
+ *     possible solutions is computed. Each of these merge nodes depends ONLY on
+ *     the partial routes it actually needs. This way, the "work hard" merge
+ *     starts as soon as its two partial routes are known, while the routes from
+ *     and to the vacation destinations are still being computed. The merges of
+ *     all "play hard" problems are run by a single node, which starts them in
+ *     descending order of their estimated work.
  *
- *  2. In the second phase, all routes from the first phase are merged into
- *     possible solutions for the "work hard" and each of the "play hard"
- *     solutions. Then the cheapest of each set of possible solutions is
- *     computed. Just like in the first phase, this is parallelized using tasks.
+ *  3. Each solution is written as soon as it is known. The "work hard" solution
+ *     is written right after its merge. The "play hard" solutions need to be
+ *     written in the order of the vacation destinations, so they pass a
+ *     sequencer that releases each solution as soon as all preceding solutions
+ *     have been written.
  *
  *  @param parameters The parameters.
  *  @param alliances  The alliances between companies.
- *  @return           A solution object containing the "Work Hard" solution and
- *                    a list of "Play Hard" solutions (one for each vacation
- *                    destination). */
-Solution play_and_work_hard(Parameters& parameters, Alliances *alliances)
+ *  @param solution   A solution object that is filled with the "Work Hard"
+ *                    solution and a list of "Play Hard" solutions (one for
+ *                    each vacation destination).
+ *  @param wh_out     Output stream for the "Work Hard" solution.
+ *  @param ph_out     Output stream for the "Play Hard" solutions. */
+void play_and_work_hard(Parameters& parameters, Alliances *alliances, Solution *solution,
+		ofstream *wh_out, ofstream *ph_out)
 {
 	int n = parameters.airports_of_interest.size();
-	Solution solution(n);
-	vector<Travel> results, home_to_conference, conference_to_home, home_to_vacation[n],
+	vector<Travel> home_to_conference, conference_to_home, home_to_vacation[n],
 			vacation_to_conference[n], conference_to_vacation[n], vacation_to_home[n];
 
-	task_list tasks, mergereduce_tasks;
+	flow::graph g;
+	flow::broadcast_node<flow::continue_msg> start(g);
+	vector<GraphNode*> nodes;
+	vector<PlayHardTask*> play_hard;
+
+	// Writers for the solutions. The "play hard" writer only accepts solutions in the
+	// order of the vacation destinations.
+	GraphNode write_work_hard(g,
+			GraphNodeBody<WriteWorkHardTask>(WriteWorkHardTask(solution, alliances, wh_out)));
+	flow::sequencer_node<unsigned int> play_hard_sequencer(g, IndexSequence());
+	flow::function_node<unsigned int> write_play_hard(g, flow::serial,
+			WritePlayHardTask(solution, &parameters, alliances, ph_out));
+	flow::make_edge(play_hard_sequencer, write_play_hard);
 
 	// Compute the "conference to home" and "home to conference" routes. There routes are
 	// needed to solve both the "work hard" and "play hard" problems. However, since these routes
 	// are completely independent from any vacation target, they need to be computed ONLY ONCE.
 
+	// The searches are spread round robin over the NUMA nodes (if there are several).
+
 	// Conference to Home
-	tasks.push_back(
-			*new (task::allocate_root()) FindPathTask(parameters.to, parameters.from,
-					parameters.ar_time_min, parameters.ar_time_max, &parameters,
-					&conference_to_home, alliances));
+	const NumaNode &n0 = numa_node(0);
+	GraphNode *cth = find_path_node(g, start, nodes,
+			FindPathTask(parameters.to, parameters.from, parameters.ar_time_min,
+					parameters.ar_time_max, &parameters, &conference_to_home, alliances,
+					n0.location_map), n0);
 	// Home to Conference
-	tasks.push_back(
-			*new (task::allocate_root()) FindPathTask(parameters.from, parameters.to,
-					parameters.dep_time_min, parameters.dep_time_max, &parameters,
-					&home_to_conference, alliances));
-
+	const NumaNode &n1 = numa_node(1);
+	GraphNode *htc = find_path_node(g, start, nodes,
+			FindPathTask(parameters.from, parameters.to, parameters.dep_time_min,
+					parameters.dep_time_max, &parameters, &home_to_conference, alliances,
+					n1.location_map), n1);
+
+	// Solve the "work hard" problem as soon as both of its partial routes are known.
+	GraphNode *wh = new GraphNode(g,
+			GraphNodeBody<WorkHardTask>(
+					WorkHardTask(&home_to_conference, &conference_to_home, solution,
+							alliances)));
+	flow::make_edge(*htc, *wh);
+	flow::make_edge(*cth, *wh);
+	flow::make_edge(*wh, write_work_hard);
+	nodes.push_back(wh);
+
+	// Small optimization: If no route from or to vacation location exist, do not
+	// bother to find routes, since it would be impossible to find any, anyhow.
+	vector<int> vacations;
 	for (int i = 0; i < n; i++)
 	{
-		string current_airport_of_interest = parameters.airports_of_interest[i];
 		concurrent_hash_map<string, Location>::const_accessor a;
-
-		// Small optimization: If no route from or to vacation location exist, do not
-		// bother to find routes, since it would be impossible to find any, anyhow.
-		if (!location_map->find(a, current_airport_of_interest)
+		if (!location_map->find(a, parameters.airports_of_interest[i])
 				|| a->second.outgoing_flights.size() == 0
 				|| a->second.incoming_flights.size() == 0)
 		{
+			Travel t;
 			a.release();
+			solution->add_play_hard(i, t);
+			play_hard_sequencer.try_put(i);
 			continue;
 		}
-		a.release();
+		vacations.push_back(i);
+	}
+
+	// The "home to vacation" and "conference to vacation" routes of ALL vacation
+	// destinations start at the same location within the same time window. Each of
+	// these two groups is computed by a single search with several destinations, so
+	// that routes that are shared by several destinations are explored only once.
+	// Likewise, the "vacation to conference" and "vacation to home" routes all END at
+	// the same location. These are computed by a single backward search each.
+	vector<string> vacation_airports;
+	vector<Travels*> htv_travels, ctv_travels, vtc_travels, vth_travels;
+	for (unsigned int j = 0; j < vacations.size(); j++)
+	{
+		vacation_airports.push_back(parameters.airports_of_interest[vacations[j]]);
+		htv_travels.push_back(&home_to_vacation[vacations[j]]);
+		ctv_travels.push_back(&conference_to_vacation[vacations[j]]);
+		vtc_travels.push_back(&vacation_to_conference[vacations[j]]);
+		vth_travels.push_back(&vacation_to_home[vacations[j]]);
+	}
 
-		// Home to Vacation[i]
-		tasks.push_back(
-				*new (task::allocate_root()) FindPathTask(parameters.from,
-						current_airport_of_interest,
+	GraphNode *htv = NULL, *ctv = NULL, *vtc = NULL, *vth = NULL;
+	if (vacations.size() > 0)
+	{
+		// Home to Vacation[*]
+		const NumaNode &n2 = numa_node(2);
+		htv = find_path_node(g, start, nodes,
+				FindPathTask(parameters.from, vacation_airports,
 						parameters.dep_time_min - parameters.vacation_time_max,
 						parameters.dep_time_min - parameters.vacation_time_min,
-						&parameters, &home_to_vacation[i], alliances));
-
-		// Vacation[i] to Conference
-		tasks.push_back(
-				*new (task::allocate_root()) FindPathTask(current_airport_of_interest,
-						parameters.to, parameters.dep_time_min, parameters.dep_time_max,
-						&parameters, &vacation_to_conference[i], alliances));
-
-		// Conference to Vacation[i]
-		tasks.push_back(
-				*new (task::allocate_root()) FindPathTask(parameters.to,
-						current_airport_of_interest, parameters.ar_time_min,
-						parameters.ar_time_max, &parameters, &conference_to_vacation[i],
-						alliances));
-
-		// Vacation[i] to Home
-		tasks.push_back(
-				*new (task::allocate_root()) FindPathTask(current_airport_of_interest,
-						parameters.from,
+						&parameters, htv_travels, alliances, n2.location_map), n2);
+
+		// Vacation[*] to Conference
+		const NumaNode &n3 = numa_node(3);
+		vtc = find_path_node(g, start, nodes,
+				FindPathTask(vacation_airports, parameters.to, parameters.dep_time_min,
+						parameters.dep_time_max, &parameters, vtc_travels, alliances,
+						n3.location_map), n3);
+
+		// Conference to Vacation[*]
+		const NumaNode &n4 = numa_node(4);
+		ctv = find_path_node(g, start, nodes,
+				FindPathTask(parameters.to, vacation_airports, parameters.ar_time_min,
+						parameters.ar_time_max, &parameters, ctv_travels, alliances,
+						n4.location_map), n4);
+
+		// Vacation[*] to Home
+		const NumaNode &n5 = numa_node(5);
+		vth = find_path_node(g, start, nodes,
+				FindPathTask(vacation_airports, parameters.from,
 						parameters.ar_time_max + parameters.vacation_time_min,
 						parameters.ar_time_max + parameters.vacation_time_max,
-						&parameters, &vacation_to_home[i], alliances));
+						&parameters, vth_travels, alliances, n5.location_map), n5);
 	}
 
-	task::spawn_root_and_wait(tasks);
-
-	// Merge the computed paths.
-	// Solve the "work hard" problem in one task, and each "play hard" problem in another
-	// seperate task.
-	// These merge/reduce tasks merge the partial routes computed in the parallel step before
-	// and search for the cheapest of the merged routes.
-	mergereduce_tasks.push_back(
-			*new (task::allocate_root()) WorkHardTask(&home_to_conference,
-					&conference_to_home, &solution, alliances));
+	for (unsigned int j = 0; j < vacations.size(); j++)
+	{
+		int i = vacations[j];
+
+		// Merge the computed paths for this vacation destination. Each problem is handed a
+		// pointer to the solution object. Since each problem knows exactly where to modify
+		// the solution object, special access synchronization is not required.
+		play_hard.push_back(
+				new PlayHardTask(&home_to_vacation[i], &vacation_to_conference[i],
+						&conference_to_home, &home_to_conference, &vacation_to_home[i],
+						&conference_to_vacation[i], solution, i, alliances,
+						&play_hard_sequencer));
+	}
 
-	for (unsigned int i = 0; i < parameters.airports_of_interest.size(); i++)
+	if (vacations.size() > 0)
 	{
-		string current_airport_of_interest = parameters.airports_of_interest[i];
-		concurrent_hash_map<string, Location>::const_accessor a;
+		// All "play hard" problems need the same six searches, so their merges are
+		// scheduled together, the largest merges first.
+		GraphNode *ph = new GraphNode(g,
+				GraphNodeBody<PlayHardScheduleTask>(PlayHardScheduleTask(&play_hard)));
+		flow::make_edge(*htc, *ph);
+		flow::make_edge(*cth, *ph);
+		flow::make_edge(*htv, *ph);
+		flow::make_edge(*vtc, *ph);
+		flow::make_edge(*ctv, *ph);
+		flow::make_edge(*vth, *ph);
+		nodes.push_back(ph);
+	}
 
-		// Small optimization: If no route from or to vacation location exist, do not
-		// bother to find routes, since it would be impossible to find any, anyhow.
-		if (!location_map->find(a, current_airport_of_interest)
-				|| a->second.outgoing_flights.size() == 0
-				|| a->second.incoming_flights.size() == 0)
-		{
-			Travel t;
-			a.release();
-			solution.add_play_hard(i, t);
-			continue;
-		}
-		a.release();
+	start.try_put(flow::continue_msg());
+	g.wait_for_all();
 
-		mergereduce_tasks.push_back(
-				*new (task::allocate_root()) PlayHardTask(&home_to_vacation[i],
-						&vacation_to_conference[i], &conference_to_home,
-						&home_to_conference, &vacation_to_home[i],
-						&conference_to_vacation[i], &solution, i, alliances));
+	for (unsigned int i = 0; i < nodes.size(); i++)
+	{
+		delete nodes[i];
 	}
 
-	// Complete all mergereduce tasks. Each task is handed a pointer to the solution object.
-	// Since each task knows exactly where to modify the solution object, special access synchronization
-	// is not required (apart from some tiny spinlock implemented in the "Solution" class).
-	// So ideally, the "solution" variable should be completely filled when all the tasks have run.
-	task::spawn_root_and_wait(mergereduce_tasks);
-
-	return solution;
+	for (unsigned int i = 0; i < play_hard.size(); i++)
+	{
+		delete play_hard[i];
+	}
 }
 
 /// Compute the cost of a travel and uses the discounts when possible.
 /** @param travel The travel.
- *  @param alliances The alliances. */
-float compute_cost(Travel *travel, Alliances*alliances)
+ *  @param alliances The alliances.
+ *  @return The total cost (in cost units, see COST_UNITS). */
+Cost compute_cost(Travel *travel, Alliances*alliances)
 {
 	// Parallelism does not make much sense here... Due to various optimizations, most
 	// travels are only 3 to 6 flights in length. Scheduling overhead becomes pretty obvious
 	// here...
-	travel->total_cost = 0;
+	Cost total = 0;
 	for (unsigned int i = 0; i < travel->flights.size(); i++)
 	{
-		travel->total_cost += travel->discounts[i] * travel->flights[i].cost;
+		total += discounted(travel->flight(i).cost, travel->discount(i));
 	}
 
-	return travel->total_cost;
+	return total;
 }
 
 /// Computes a path from a point A to a point B.
@@ -196,58 +296,187 @@ float compute_cost(Travel *travel, Alliances*alliances)
  *  to take the layover in consideration.
  *
  *  Optimization: This method now uses task-based parallelism in order to
- *  compute possible paths in parallel.
+ *  compute possible paths in parallel. Several destinations can be searched
+ *  at once, so that each route from the starting point is explored only once.
  *
- *  @param to            The destination.
+ *  In backward mode, the travels grow from the destination towards the
+ *  targets (which are the possible origins of the routes then).
+ *
+ *  @param targets       The destinations. Found routes are stored here.
  *  @param travels       The list of possible travels that we are building.
  *  @param t_min         You must not be in a plane before this value (epoch)
  *  @param t_max         You must not be in a plane after this value (epoch)
  *  @param parameters    The program parameters
- *  @param final_travels The output vector.
- *  @param min_range     The minimum price range in which all found routes must fit.
- *  @param alliances     The global alliance vector. */
-void compute_path(string to, vector<Travel> *travels, unsigned long t_min,
-		unsigned long t_max, Parameters parameters, vector<Travel> *final_travels,
-		CostRange *min_range, Alliances *alliances)
+ *  @param alliances     The global alliance vector.
+ *  @param forward       TRUE for a forward search, FALSE for a backward search.
+ *  @param lm            The flight graph. */
+void compute_path(PathTargets *targets, vector<Travel> *travels, unsigned long t_min,
+		unsigned long t_max, Parameters *parameters, Alliances *alliances, bool forward,
+		concurrent_hash_map<string, Location> *lm)
 {
-	mutex final_travels_lock;
-
-	tbb::task_list tl;
+	task_group group;
 
 	unsigned int s = travels->size();
 	for (unsigned int i = 0; i < s; i++)
 	{
-		tl.push_back(
-				*new (tbb::task::allocate_root()) ComputePathTask(&(travels->at(i)), to,
-						final_travels, &final_travels_lock, t_min, t_max, &parameters,
-						alliances, min_range, location_map, 0));
+		group.run(
+				ComputePathTask(travels->at(i), targets, forward, t_min, t_max,
+						parameters, alliances, lm, &group, 0));
+	}
+
+	group.wait();
+}
+
+/// Computes a path from a point A to a point B by searching from both ends.
+/** This function searches forward from the origin and backward from the
+ *  destination at the same time (each half search in its own task). Both half
+ *  searches are limited to "parameters->bidirectional_depth" flights, which
+ *  means that routes of up to twice this length are found. Afterwards, the
+ *  partial routes of both half searches are joined at each intermediate city
+ *  where both searches met.
+ *
+ *  In comparison to "compute_path", the depth of each half search is only half
+ *  the length of the route, which keeps the number of explored routes small for
+ *  far-apart locations.
+ *
+ *  @param from          The origin.
+ *  @param to            The destination.
+ *  @param t_min         You must not be in a plane before this value (epoch)
+ *  @param t_max         You must not be in a plane after this value (epoch)
+ *  @param parameters    The program parameters
+ *  @param targets       The destination (the only target). Found routes are
+ *                       stored here.
+ *  @param alliances     The global alliance vector.
+ *  @param lm            The flight graph. */
+void compute_path_bidirectional(const string &from, const string &to,
+		unsigned long t_min, unsigned long t_max, Parameters *parameters,
+		PathTargets *targets, Alliances *alliances, concurrent_hash_map<string, Location> *lm)
+{
+	RoutesByCity forward, backward;
+	task_group halves;
+
+	halves.run(
+			HalfPathTask(from, to, true, &forward, targets, t_min, t_max, parameters,
+					alliances, lm));
+	halves.run(
+			HalfPathTask(to, from, false, &backward, targets, t_min, t_max, parameters,
+					alliances, lm));
+
+	halves.wait();
+
+	// Collect all cities where both half searches met.
+	vector<string> cities;
+	RoutesByCity::iterator i;
+	for (i = forward.begin(); i != forward.end(); ++i)
+	{
+		if (backward.find(i->first) != backward.end())
+		{
+			cities.push_back(i->first);
+		}
+	}
+
+	MeetInTheMiddleLoop mitml(&cities, &forward, &backward, targets,
+			parameters->max_layover_time, parameters->max_hops, alliances);
+	parallel_for(blocked_range<unsigned int>(0, cities.size()), mitml);
+}
+
+/// Builds the route cache key of a partial route search.
+static RouteCacheKey route_cache_key(const string &from, const string &to,
+		unsigned long t_min, unsigned long t_max, Parameters *parameters, unsigned int depth)
+{
+	RouteCacheKey k;
+	k.from = from;
+	k.to = to;
+	k.t_min = t_min;
+	k.t_max = t_max;
+	k.max_layover_time = parameters->max_layover_time;
+	k.max_hops = parameters->max_hops;
+	k.bidirectional_depth = depth;
+
+	return k;
+}
+
+/// Looks up the routes between two locations in the route cache.
+/** @param from       The origin.
+ *  @param to         The destination.
+ *  @param t_min      You must not be in a plane before this value (epoch).
+ *  @param t_max      You must not be in a plane after this value (epoch).
+ *  @param parameters The program parameters.
+ *  @param depth      Depth of the bidirectional search (0 = forward search).
+ *  @param travels    Output vector.
+ *  @return           TRUE if the routes were found in the cache. */
+bool cached_routes(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max, Parameters *parameters, unsigned int depth, Travels *travels)
+{
+	if (route_cache == NULL)
+	{
+		return false;
+	}
+
+	return route_cache->find(
+			route_cache_key(from, to, t_min, t_max, parameters, depth), travels);
+}
+
+/// Stores the routes between two locations in the route cache.
+/** @see cached_routes */
+void cache_routes(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max, Parameters *parameters, unsigned int depth, Travels *travels)
+{
+	if (route_cache != NULL)
+	{
+		route_cache->insert(route_cache_key(from, to, t_min, t_max, parameters, depth),
+				*travels);
+	}
+}
+
+/// Computes a version number of the flight data.
+/** The version number is built from size and modification time of the flights
+ *  and alliances files. Cached routes of other flight data versions are ignored.
+ *
+ *  @param parameters The program parameters.
+ *  @return           The version number. */
+unsigned long flight_data_version(Parameters &parameters)
+{
+	struct stat f, a;
+	unsigned long v = 14695981039346656037UL;
+
+	if (stat(parameters.flights_file.c_str(), &f) == 0)
+	{
+		v = (v ^ (unsigned long) f.st_size) * 1099511628211UL;
+		v = (v ^ (unsigned long) f.st_mtime) * 1099511628211UL;
 	}
 
-	tbb::task::spawn_root_and_wait(tl);
+	if (stat(parameters.alliances_file.c_str(), &a) == 0)
+	{
+		v = (v ^ (unsigned long) a.st_size) * 1099511628211UL;
+		v = (v ^ (unsigned long) a.st_mtime) * 1099511628211UL;
+	}
 
-	return;
+	return v;
 }
 
 /// Fills the travels's vector with flights that take off from the starting_point.
 /** @param travels           A vector of travels under construction
- *  @param final_travels     Output vector for found routes to destination.
+ *  @param targets           The destinations. Direct routes to a destination are stored
+ *                           here (and are not further processed if there is only one
+ *                           destination).
  *  @param starting_point    The starting point.
- *  @param travels           The list of possible travels that we are building.
  *  @param t_min             You must not be in a plane before this value (epoch).
  *  @param t_max             You must not be in a plane after this value (epoch).
- *  @param min_range         The minimum price range in which all found routes must fit.
  *  @param alliances         The global alliance vector.
- *  @param destination_point The travel destination point. Direct routes between start
- *                           and destination are not further processed. */
-void fill_travel(Travels *travels, Travels *final_travels, string starting_point,
-		unsigned long t_min, unsigned long t_max, CostRange *min_range,
-		string destination_point, Alliances *alliances)
+ *  @param forward           TRUE for a forward search. For a backward search, the
+ *                           flights that land at the starting point are used.
+ *  @param lm                The flight graph. */
+void fill_travel(Travels *travels, PathTargets *targets, const string &starting_point,
+		unsigned long t_min, unsigned long t_max, Alliances *alliances, bool forward,
+		concurrent_hash_map<string, Location> *lm)
 {
 	const Location *l;
 	concurrent_hash_map<string, Location>::const_accessor a;
 	Travels temp;
+	CostRange bound;
 
-	if (!location_map->find(a, starting_point))
+	if (!lm->find(a, starting_point))
 	{
 		cerr << "Location " << starting_point << " is unknown!";
 		return;
@@ -255,35 +484,183 @@ void fill_travel(Travels *travels, Travels *final_travels, string starting_point
 
 	l = &(a->second);
 
-	unsigned int s = l->outgoing_flights.size();
+	const vector<Flight> *flights = forward ? &(l->outgoing_flights) : &(l->incoming_flights);
+
+	StatsCounters &c = stats_counters();
+	unsigned int s = flights->size();
+
+	// The starting point is level 0 of the search profile (a route without flights).
+	SearchLevel *level = NULL;
+	if (targets->profile != NULL)
+	{
+		level = &(targets->profile->level(0));
+		level->routes++;
+		level->edges += s;
+	}
+
 	for (unsigned int i = 0; i < s; i++)
 	{
-		Flight *f = (Flight*) &(l->outgoing_flights[i]);
-		if (f->take_off_time >= t_min && f->land_time <= t_max
-				&& f->cost * 0.7 <= min_range->max)
+		Flight *f = (Flight*) &((*flights)[i]);
+		if (f->take_off_time < t_min || f->land_time > t_max)
 		{
-			Travel t;
-			t.add_flight(*f, alliances);
+			if (level != NULL) level->failed[PREDICATE_TIME_WINDOW]++;
+			continue;
+		}
 
-			if (f->to == destination_point)
-			{
-				min_range->from_travel(&t);
-				final_travels->push_back(t);
-			}
-			else
-			{
-				temp.push_back(t);
-			}
+		if (discounted(f->cost, 70)
+				> targets->bound(forward ? f->to : f->from,
+						forward ? f->land_time : f->take_off_time))
+		{
+			if (level != NULL) level->failed[PREDICATE_COST_ESTIMATE]++;
+			c.routes_pruned++;
+			continue;
+		}
+
+		Travel t;
+		t.add_flight(*f, alliances);
+		c.routes_expanded++;
+		if (level != NULL) level->accepted++;
+
+		int target = targets->find(forward ? f->to : f->from);
+		if (target >= 0 && targets->size() == 1)
+		{
+			targets->move_travel(target, &t);
+			continue;
+		}
+
+		if (target >= 0)
+		{
+			targets->add_travel(target, &t);
 		}
+		temp.push_back(std::move(t));
 	}
 
-	FilterPathsLoop fpl(&temp, travels, min_range);
+	// Routes that already are more expensive than all destinations can be dropped.
+	PhaseTimer timer("filter_initial", starting_point);
+	bound.max = targets->max.load();
+	FilterPathsLoop fpl(&temp, travels, &bound);
 
 	if (temp.size() > 500) parallel_reduce(blocked_range<unsigned int>(0, temp.size()),
 			fpl);
 	else fpl(blocked_range<unsigned int>(0, temp.size()));
 }
 
+/// Tests if a route between two locations can exist at all.
+/** This function uses the connection scan timetable as a cheap oracle. Since the
+ *  timetable is optimistic, a negative answer means that the route search would
+ *  not find any route, either.
+ *
+ *  @param from  The origin.
+ *  @param to    The destination.
+ *  @param t_min You must not be in a plane before this value (epoch).
+ *  @param t_max You must not be in a plane after this value (epoch).
+ *  @return      FALSE if no route can exist. */
+bool route_exists(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max)
+{
+	if (connection_scan == NULL)
+	{
+		return true;
+	}
+
+	return connection_scan->reachable(from, to, t_min, t_max);
+}
+
+/// Lets a route search prune with the bounds of the destinations it can still reach.
+/** Without the connection scan timetable, the search prunes with the highest
+ *  bound of all destinations.
+ *
+ *  @param targets The destinations of the search.
+ *  @param forward TRUE for a forward search, FALSE for a backward search.
+ *  @param t_min   You must not be in a plane before this value (epoch).
+ *  @param t_max   You must not be in a plane after this value (epoch). */
+void use_timetable(PathTargets *targets, bool forward, unsigned long t_min,
+		unsigned long t_max)
+{
+	if (connection_scan != NULL)
+	{
+		targets->use_timetable(connection_scan, forward, t_min, t_max);
+	}
+}
+
+/// Writes a time in the same format as "print_flight".
+static void print_time(unsigned long t, ofstream &output)
+{
+	struct tm *tm_t = gmtime((const time_t*) &t);
+	output << (tm_t->tm_mon + 1) << "/" << tm_t->tm_mday << " " << tm_t->tm_hour << "h"
+			<< tm_t->tm_min << "min";
+}
+
+/// Writes the earliest arrival and the departure profile between two cities.
+/** @param from   The origin.
+ *  @param to     The destination.
+ *  @param t_min  You must not be in a plane before this value (epoch).
+ *  @param t_max  You must not be in a plane after this value (epoch).
+ *  @param output The output stream. */
+static void write_timetable_leg(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max, ofstream &output)
+{
+	output << from << " -> " << to << endl;
+
+	unsigned long ea = connection_scan->earliest_arrival(from, to, t_min, t_max);
+	if (ea == NOT_REACHABLE)
+	{
+		output << "    not reachable" << endl;
+		return;
+	}
+
+	output << "    earliest arrival: ";
+	print_time(ea, output);
+	output << endl;
+
+	Profile p;
+	connection_scan->profile(from, to, t_min, t_max, &p);
+	for (unsigned int i = 0; i < p.size(); i++)
+	{
+		output << "    departure ";
+		print_time(p[i].departure, output);
+		output << ", arrival ";
+		print_time(p[i].arrival, output);
+		output << endl;
+	}
+}
+
+/// Writes the earliest arrivals and departure profiles of all partial routes.
+/** The partial routes and their time windows are the same as in
+ *  "play_and_work_hard". The connection scan ignores costs and cities that are
+ *  visited twice, so this is an optimistic overview of the timetable.
+ *
+ *  @param parameters The parameters.
+ *  @param filename   The output file name.
+ *  @return           TRUE if the file could be written. */
+bool write_timetable_report(Parameters &parameters, const string &filename)
+{
+	ofstream output(filename.c_str());
+	if (!output.is_open()) return false;
+
+	write_timetable_leg(parameters.from, parameters.to, parameters.dep_time_min,
+			parameters.dep_time_max, output);
+	write_timetable_leg(parameters.to, parameters.from, parameters.ar_time_min,
+			parameters.ar_time_max, output);
+
+	for (unsigned int i = 0; i < parameters.airports_of_interest.size(); i++)
+	{
+		const string &v = parameters.airports_of_interest[i];
+		write_timetable_leg(parameters.from, v,
+				parameters.dep_time_min - parameters.vacation_time_max,
+				parameters.dep_time_min - parameters.vacation_time_min, output);
+		write_timetable_leg(v, parameters.to, parameters.dep_time_min,
+				parameters.dep_time_max, output);
+		write_timetable_leg(parameters.to, v, parameters.ar_time_min,
+				parameters.ar_time_max, output);
+		write_timetable_leg(v, parameters.from,
+				parameters.ar_time_max + parameters.vacation_time_min,
+				parameters.ar_time_max + parameters.vacation_time_max, output);
+	}
+
+	return output.good();
+}
+
 /// Convert a date to timestamp
 /** @return a timestamp (epoch) corresponding to the given parameters. */
 time_t convert_to_timestamp(int day, int month, int year, int hour, int minute,
@@ -435,13 +812,25 @@ void print_params(Parameters &parameters)
 	cout << "flights : " << parameters.flights_file << endl;
 	cout << "alliances : " << parameters.alliances_file << endl;
 	cout << "nb_threads : " << parameters.nb_threads << endl;
+	cout << "task_cutoff_level : " << parameters.task_cutoff_level << endl;
+	cout << "max_hops : " << parameters.max_hops << endl;
+	cout << "bidirectional_depth : " << parameters.bidirectional_depth << endl;
+	cout << "route_cache_file : " << parameters.route_cache_file << endl;
+	cout << "memory_budget : " << parameters.memory_budget << endl;
+	cout << "count_allocations : " << parameters.count_allocations << endl;
+	cout << "stats_file : " << parameters.stats_file << endl;
+	cout << "search_profile_file : " << parameters.search_profile_file << endl;
+	cout << "perf_counters : " << parameters.perf_counters << endl;
+	cout << "numa : " << parameters.numa << endl;
+	cout << "timetable_file : " << parameters.timetable_file << endl;
+	cout << "trace_file : " << parameters.trace_file << endl;
 }
 
 /// You can use this function to display a flight
 /** @param flight   The flight.
- *  @param discount The discount.
+ *  @param discount The discount (percentage of the cost that needs to be paid).
  *  @param output   The output stream. */
-void print_flight(Flight& flight, float discount, ofstream& output)
+void print_flight(const Flight& flight, unsigned int discount, ofstream& output)
 {
 	struct tm * take_off_t, *land_t;
 	take_off_t = gmtime(((const time_t*) &(flight.take_off_time)));
@@ -453,7 +842,7 @@ void print_flight(Flight& flight, float discount, ofstream& output)
 	land_t = gmtime(((const time_t*) &(flight.land_time)));
 	output << flight.to << " (" << (land_t->tm_mon + 1) << "/" << land_t->tm_mday << " "
 			<< land_t->tm_hour << "h" << land_t->tm_min << "min" << ")-";
-	output << flight.cost << "$" << "-" << discount * 100 << "%" << endl;
+	output << (double) flight.cost / COST_UNITS << "$" << "-" << discount << "%" << endl;
 
 }
 
@@ -463,6 +852,20 @@ void print_flight(Flight& flight, float discount, ofstream& output)
  *  @param argv Command line parameters. */
 void read_parameters(Parameters& parameters, int argc, char **argv)
 {
+	parameters.nb_threads = 0;
+	parameters.task_cutoff_level = 3;
+	parameters.max_hops = 0;
+	parameters.bidirectional_depth = 0;
+	parameters.route_cache_file = "";
+	parameters.memory_budget = 0;
+	parameters.count_allocations = false;
+	parameters.stats_file = "";
+	parameters.search_profile_file = "";
+	parameters.perf_counters = false;
+	parameters.numa = false;
+	parameters.timetable_file = "";
+	parameters.trace_file = "";
+
 	for (int i = 0; i < argc; i++)
 	{
 		string current_parameter = argv[i];
@@ -529,6 +932,54 @@ void read_parameters(Parameters& parameters, int argc, char **argv)
 		{
 			parameters.nb_threads = atoi(argv[++i]);
 		}
+		else if (current_parameter == "-task_cutoff")
+		{
+			parameters.task_cutoff_level = atoi(argv[++i]);
+		}
+		else if (current_parameter == "-max_hops")
+		{
+			parameters.max_hops = atoi(argv[++i]);
+		}
+		else if (current_parameter == "-bidirectional")
+		{
+			parameters.bidirectional_depth = atoi(argv[++i]);
+		}
+		else if (current_parameter == "-route_cache")
+		{
+			parameters.route_cache_file = argv[++i];
+		}
+		else if (current_parameter == "-memory_budget")
+		{
+			parameters.memory_budget = atol(argv[++i]);
+		}
+		else if (current_parameter == "-count_allocations")
+		{
+			parameters.count_allocations = true;
+		}
+		else if (current_parameter == "-stats")
+		{
+			parameters.stats_file = argv[++i];
+		}
+		else if (current_parameter == "-search_profile")
+		{
+			parameters.search_profile_file = argv[++i];
+		}
+		else if (current_parameter == "-perf_counters")
+		{
+			parameters.perf_counters = true;
+		}
+		else if (current_parameter == "-numa")
+		{
+			parameters.numa = true;
+		}
+		else if (current_parameter == "-timetable_file")
+		{
+			parameters.timetable_file = argv[++i];
+		}
+		else if (current_parameter == "-trace")
+		{
+			parameters.trace_file = argv[++i];
+		}
 
 	}
 }
@@ -548,6 +999,21 @@ void split_string(vector<string>& result, string line, char separator)
 	result.push_back(line);
 }
 
+/// Joins strings.
+/** @param strings   The strings.
+ *  @param separator Separator between two strings.
+ *  @return          The joined string. */
+string join_strings(const vector<string>& strings, char separator)
+{
+	string result;
+	for (unsigned int i = 0; i < strings.size(); i++)
+	{
+		if (i > 0) result += separator;
+		result += strings[i];
+	}
+	return result;
+}
+
 /// Parses a line containing a flight description.
 /** This function parses a string containing a flight description.
  *
@@ -562,8 +1028,10 @@ void split_string(vector<string>& result, string line, char separator)
  *      to certain locations.
  *
  *  @param l       The line that must be parsed.
+ *  @param index   The position of the flight in "Travel::flight_table", i.e. its
+ *                 line in the input file. Cost ties are broken by this order.
  *  @param param   A pointer to the input parameter object.*/
-void parse_flight(char *l, Parameters *param)
+void parse_flight(char *l, unsigned int index, Parameters *param)
 {
 	unsigned int p[7];
 
@@ -596,9 +1064,13 @@ void parse_flight(char *l, Parameters *param)
 	flight.id = string(&o[0]);
 	flight.from = string(&(o[p[0] + 1]));
 	flight.to = string(&(o[p[2] + 1]));
-	flight.cost = atof(&(o[p[4] + 1]));
+	flight.cost = llround(atof(&(o[p[4] + 1])) * (COST_UNITS / 100)) * 100;
 	flight.company = string(&(o[p[5] + 1]));
-	flight.discout = 1.0;
+	flight.index = index;
+
+	// Travels only refer to the flight by its index in the flight table. Each line
+	// has its own slot in the table, so no synchronization is needed here.
+	Travel::flight_table[index] = flight;
 
 	// Build a big graph from all locations and the flights connecting them.
 	// We store all known locations (i.e. targets and origins of our flights)
@@ -645,6 +1117,7 @@ void parse_flights(string filename, Parameters *parameters)
 	struct stat stat;
 	int fd;
 	off_t l;
+	PhaseTimer timer("parse_flights");
 
 	// Try to open the input file and do a stat() syscall on it.
 	// Exit with an error message if either operation fails.
@@ -678,7 +1151,9 @@ void parse_flights(string filename, Parameters *parameters)
 		}
 	}
 
-	// Iterate over all found linefeeds and parse each line in parallel.
+	// Iterate over all found linefeeds and parse each line in parallel. The flight
+	// in line i is stored at index i - 1 of the flight table.
+	Travel::flight_table.resize(lfs.size() - 1);
 	ParseFlightsLoop pfl(m, &lfs, parameters);
 	parallel_for(blocked_range<int>(1, lfs.size()), pfl);
 
@@ -708,6 +1183,7 @@ void parse_alliances(Alliances *alliances, string filename)
 {
 	string line = "";
 	ifstream file;
+	PhaseTimer timer("parse_alliances");
 
 	file.open(filename.c_str());
 	if (!file.is_open())
@@ -728,7 +1204,9 @@ void parse_alliances(Alliances *alliances, string filename)
 /** Based on the assumption that there are relatively few possible combinations
  *  of airlines, this function used a cache based on a "tbb::concurrent_hash_map<string,bool>"
  *  in which each combination of airlines is stored. Each entry is created with the
- *  first call with a certain company combination.
+ *  first call with a certain company combination. Known combinations are looked
+ *  up with a read lock, and the key is built in a buffer of the calling thread, so
+ *  that a lookup does not allocate any memory.
  *
  *  @param c1        The first company's name.
  *  @param c2        The second company's name.
@@ -737,8 +1215,18 @@ void parse_alliances(Alliances *alliances, string filename)
 bool company_are_in_a_common_alliance(const string& c1, const string& c2,
 		Alliances *alliances)
 {
+	static thread_local string key;
+	key.assign(c1 < c2 ? c1 : c2).append(c1 < c2 ? c2 : c1);
+
+	concurrent_hash_map<string, bool>::const_accessor ca;
+	if (alliance_map.find(ca, key))
+	{
+		return ca->second;
+	}
+	ca.release();
+
 	concurrent_hash_map<string, bool>::accessor a;
-	if (alliance_map.insert(a, c1 < c2 ? c1 + c2 : c2 + c1))
+	if (alliance_map.insert(a, key))
 	{
 		for (unsigned int i = 0; i < alliances->size(); i++)
 		{
@@ -800,14 +1288,13 @@ void print_alliances(Alliances &alliances)
 }
 
 /// Display the flights on the standard output.
-/** @param flights The flights.
- *  @param discounts Discounts for each flight.
+/** @param travel The travel containing the flights (and their discounts).
  *  @param output The output stream to be used. */
-void print_flights(vector<Flight>& flights, vector<float> discounts, ofstream& output)
+void print_flights(const Travel &travel, ofstream& output)
 {
-	for (unsigned int i = 0; i < flights.size(); i++)
+	for (unsigned int i = 0; i < travel.flights.size(); i++)
 	{
-		print_flight(flights[i], discounts[i], output);
+		print_flight(travel.flight(i), travel.discount(i), output);
 	}
 }
 
@@ -817,11 +1304,12 @@ void print_flights(vector<Flight>& flights, vector<float> discounts, ofstream& o
  *  @param travel The travels.
  *  @param city The city.
  *  @return The current travel has never visited the given city. */
-bool nerver_traveled_to(Travel travel, string city)
+bool nerver_traveled_to(const Travel &travel, const string &city)
 {
 	for (unsigned int i = 0; i < travel.flights.size(); i++)
 	{
-		if (travel.flights[i].from == city || travel.flights[i].to == city)
+		const Flight *f = &(travel.flight(i));
+		if (f->from == city || f->to == city)
 		{
 			return false;
 		}
@@ -835,42 +1323,32 @@ bool nerver_traveled_to(Travel travel, string city)
  *  @param output The output stream. */
 void print_travel(Travel& travel, Alliances *alliances, ofstream& output)
 {
-	// Sometimes prices seem to differ one cents (possibly due to some float
-	// arithmetics issues), so we compute the actual travel cost again for
-	// output.
-
-	output << "Price : " << compute_cost(&travel, alliances) << endl;
-	print_flights(travel.flights, travel.discounts, output);
+	// The price is computed again from the flights' costs and discounts (this is
+	// exact, since costs are fixed-point integers).
+	output << "Price : " << (double) compute_cost(&travel, alliances) / COST_UNITS << endl;
+	print_flights(travel, output);
 	output << endl;
 }
 
 /// Outputs solutions of both "work hard" and "play hard" problems.
-/** This method first solves both the "work hard" and all "play hard" problems
- *  and then writes the solutions into the associated output files.
+/** This method solves both the "work hard" and all "play hard" problems. The
+ *  solutions are written into the associated output files as soon as they are
+ *  known.
  *
  *  @param parameters The parameters.
  *  @param alliances The alliances between companies. */
 void output_solutions(Parameters& parameters, Alliances *alliances)
 {
-	// Solve everything.
-	Solution solution = play_and_work_hard(parameters, alliances);
-
+	Solution solution(parameters.airports_of_interest.size());
 	ofstream ph_out, wh_out;
 
 	ph_out.open(parameters.play_hard_file.c_str());
 	wh_out.open(parameters.work_hard_file.c_str());
 
-	vector<string> cities = parameters.airports_of_interest;
-	for (unsigned int i = 0; i < cities.size(); i++)
-	{
-		ph_out << "“Play Hard” Proposition " << (i + 1) << " : " << cities[i] << endl;
-		print_travel(solution.play_hard[i], alliances, ph_out);
-		ph_out << endl;
-	}
-	ph_out.close();
+	// Solve everything.
+	play_and_work_hard(parameters, alliances, &solution, &wh_out, &ph_out);
 
-	wh_out << "“Work Hard” Proposition :" << endl;
-	print_travel(solution.work_hard, alliances, wh_out);
+	ph_out.close();
 	wh_out.close();
 }
 
@@ -888,18 +1366,21 @@ void print_cities()
 		for (uint j = 0; j < i->second.outgoing_flights.size(); j++)
 		{
 			cout << "        ";
-			print_flight(i->second.outgoing_flights[j], 1.0, (ofstream&) cout);
+			print_flight(i->second.outgoing_flights[j], 100, (ofstream&) cout);
 		}
 
 		cout << "    INCOMING:" << endl;
 		for (uint j = 0; j < i->second.incoming_flights.size(); j++)
 		{
 			cout << "        ";
-			print_flight(i->second.incoming_flights[j], 1.0, (ofstream&) cout);
+			print_flight(i->second.incoming_flights[j], 100, (ofstream&) cout);
 		}
 	}
 }
 
+// The microbenchmarks (tools/microbench.cpp) use the functions of this file, but
+// have their own main function.
+#ifndef NO_MAIN
 int main(int argc, char **argv)
 {
 	// Declare variables and read the args
@@ -907,8 +1388,21 @@ int main(int argc, char **argv)
 	Alliances *alliances = new Alliances();
 	read_parameters(parameters, argc, argv);
 
-	// Respect nb_threads parameter.
-	task_scheduler_init init(parameters.nb_threads);
+	// Respect nb_threads parameter (by default, one thread per core is used).
+	global_control init(global_control::max_allowed_parallelism,
+			parameters.nb_threads > 0 ? parameters.nb_threads : info::default_concurrency());
+
+	// Hardware events are counted per thread, so this needs to be done before any
+	// thread is started.
+	if (parameters.perf_counters)
+	{
+		enable_perf_counters();
+	}
+
+	if (parameters.trace_file != "")
+	{
+		Tracer::enable(TRACE_BUFFER_EVENTS);
+	}
 
 	// Initialize flight graph (important: needs to be allocated on heap, otherwise
 	// everything will blow up on larger input datasets).
@@ -918,11 +1412,78 @@ int main(int argc, char **argv)
 	parse_flights(parameters.flights_file, &parameters);
 	parse_alliances(alliances, parameters.alliances_file);
 
+	// On machines with several NUMA nodes, each node gets its own copy of the flight
+	// graph (this falls back to the original graph on single node machines).
+	init_numa_nodes(location_map, parameters.numa);
+
+	// Sort all flights into a timetable. The timetable is used as a pruning
+	// oracle for the route search.
+	{
+		PhaseTimer timer("build_timetable");
+		connection_scan = new ConnectionScan(location_map, parameters.max_layover_time);
+	}
+
+	if (parameters.timetable_file != ""
+			&& !write_timetable_report(parameters, parameters.timetable_file))
+	{
+		cerr << "Could not write timetable " << parameters.timetable_file << endl;
+	}
+
+	// Found routes beyond the memory budget are moved to temporary files.
+	RouteStore::set_memory_budget(parameters.memory_budget * 1024 * 1024);
+
+	// Partial routes of earlier runs can be reused, as long as the flight data
+	// did not change.
+	if (parameters.route_cache_file != "")
+	{
+		route_cache = new RouteCache(flight_data_version(parameters));
+		route_cache->load(parameters.route_cache_file);
+	}
+
+	count_allocations(parameters.count_allocations);
+
 	tick_count t0 = tick_count::now();
-	output_solutions(parameters, alliances);
+	{
+		PhaseTimer timer("solve");
+		output_solutions(parameters, alliances);
+	}
 	tick_count t1 = tick_count::now();
 
+	count_allocations(false);
+
+	if (route_cache != NULL && !route_cache->save(parameters.route_cache_file))
+	{
+		cerr << "Could not write route cache " << parameters.route_cache_file << endl;
+	}
+
 	cout << "Duration: " << (t1 - t0).seconds() * 1000 << endl;
+
+	if (parameters.count_allocations)
+	{
+		cout << "Allocations: " << allocation_count() << endl;
+	}
+
+	if (perf_counters_enabled())
+	{
+		print_phase_counters(cout);
+	}
+
+	if (parameters.stats_file != "" && !write_stats(parameters.stats_file))
+	{
+		cerr << "Could not write statistics " << parameters.stats_file << endl;
+	}
+
+	if (parameters.trace_file != "" && !Tracer::write(parameters.trace_file))
+	{
+		cerr << "Could not write trace " << parameters.trace_file << endl;
+	}
+
+	if (parameters.search_profile_file != ""
+			&& !write_search_profiles(parameters.search_profile_file))
+	{
+		cerr << "Could not write search profiles " << parameters.search_profile_file << endl;
+	}
 }
+#endif
 
 //./run -from Paris -to Los\ Angeles -departure_time_min 11152012000000 -departure_time_max 11172012000000 -arrival_time_min 11222012000000 -arrival_time_max 11252012000000 -max_layover 100000 -vacation_time_min 432000 -vacation_time_max 604800 -vacation_airports Rio London Chicago -flights flights.txt -alliances alliances.txt
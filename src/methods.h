@@ -8,15 +8,30 @@
 #ifndef METHODS_H_
 #define METHODS_H_
 
+#include "tbb/concurrent_hash_map.h"
+
 #include "types.h"
 
-bool nerver_traveled_to(Travel travel, string city);
-void fill_travel(Travels *travels, Travels *final_travels, string starting_point,
-		unsigned long t_min, unsigned long t_max, CostRange *min_range,
-		string destination_point, Alliances *alliances);
-void compute_path(string to, vector<Travel> *travels, unsigned long t_min,
-		unsigned long t_max, Parameters parameters, vector<Travel> *final_travels,
-		CostRange *min_range, Alliances *alliances);
+bool nerver_traveled_to(const Travel &travel, const string &city);
+void fill_travel(Travels *travels, PathTargets *targets, const string &starting_point,
+		unsigned long t_min, unsigned long t_max, Alliances *alliances, bool forward,
+		tbb::concurrent_hash_map<string, Location> *lm);
+void compute_path(PathTargets *targets, vector<Travel> *travels, unsigned long t_min,
+		unsigned long t_max, Parameters *parameters, Alliances *alliances, bool forward,
+		tbb::concurrent_hash_map<string, Location> *lm);
+bool route_exists(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max);
+void use_timetable(PathTargets *targets, bool forward, unsigned long t_min,
+		unsigned long t_max);
+bool cached_routes(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max, Parameters *parameters, unsigned int depth, Travels *travels);
+void cache_routes(const string &from, const string &to, unsigned long t_min,
+		unsigned long t_max, Parameters *parameters, unsigned int depth, Travels *travels);
+unsigned long flight_data_version(Parameters &parameters);
+bool write_timetable_report(Parameters &parameters, const string &filename);
+void compute_path_bidirectional(const string &from, const string &to,
+		unsigned long t_min, unsigned long t_max, Parameters *parameters,
+		PathTargets *targets, Alliances *alliances, tbb::concurrent_hash_map<string, Location> *lm);
 bool company_are_in_a_common_alliance(const string& c1, const string& c2,
 		Alliances *alliances);
 bool has_just_traveled_with_company(Flight *flight_before, Flight *current_flight);
@@ -26,18 +41,20 @@ time_t convert_to_timestamp(int day, int month, int year, int hour, int minute,
 		int seconde);
 time_t convert_string_to_timestamp(char *s);
 void print_params(Parameters &parameters);
-void print_flight(Flight& flight, float discount, ofstream& output);
+void print_flight(const Flight& flight, unsigned int discount, ofstream& output);
 void read_parameters(Parameters& parameters, int argc, char **argv);
 void split_string(vector<string>& result, string line, char separator);
-void parse_flight(char *line, Parameters *p);
+string join_strings(const vector<string>& strings, char separator);
+void parse_flight(char *line, unsigned int index, Parameters *p);
 void parse_flights(string filename, Parameters *parameters);
 void parse_alliance(vector<string> &alliance, string line);
 void parse_alliances(Alliances *alliances, string filename);
-float compute_cost(Travel *travel, Alliances *alliances);
+Cost compute_cost(Travel *travel, Alliances *alliances);
 void print_alliances(Alliances &alliances);
-void print_flights(vector<Flight>& flights, vector<float> discounts, ofstream& output);
+void print_flights(const Travel &travel, ofstream& output);
 void print_travel(Travel& travel, Alliances *alliances, ofstream& output);
-Solution play_and_work_hard(Parameters& parameters, Alliances *alliances);
+void play_and_work_hard(Parameters& parameters, Alliances *alliances, Solution *solution,
+		ofstream *wh_out, ofstream *ph_out);
 time_t timegm(struct tm *tm);
 void print_cities();
 
@@ -0,0 +1,58 @@
+/*!
+ * @file allocation_counter.cpp
+ * @brief This file contains the implementation of the heap allocation counter.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "allocation_counter.h"
+
+using namespace std;
+
+/// TRUE while allocations are counted.
+static atomic<bool> counting(false);
+
+/// Number of counted allocations.
+static atomic<unsigned long> allocations(0);
+
+void oma::count_allocations(bool c)
+{
+	counting.store(c, memory_order_relaxed);
+}
+
+unsigned long oma::allocation_count()
+{
+	return allocations.load(memory_order_relaxed);
+}
+
+// Replacements of the global allocation functions. The array and nothrow
+// variants of the standard library forward to these.
+void *operator new(size_t s)
+{
+	if (counting.load(memory_order_relaxed))
+	{
+		allocations.fetch_add(1, memory_order_relaxed);
+	}
+
+	void *p = malloc(s == 0 ? 1 : s);
+	if (p == NULL)
+	{
+		throw bad_alloc();
+	}
+
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t s) noexcept
+{
+	free(p);
+}
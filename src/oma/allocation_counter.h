@@ -0,0 +1,27 @@
+/*!
+ * @file allocation_counter.h
+ * @brief This file contains declarations for the heap allocation counter.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef ALLOCATIONCOUNTER_H_
+#define ALLOCATIONCOUNTER_H_
+
+namespace oma
+{
+
+/// Starts or stops counting heap allocations.
+/** All allocations via "operator new" (i.e. all allocations of STL containers
+ *  and all objects created with "new") are counted while counting is enabled.
+ *  When counting is disabled, the only overhead is one flag test per allocation.
+ *
+ *  @param c TRUE to start counting, FALSE to stop. */
+void count_allocations(bool c);
+
+/// Gets the number of counted heap allocations.
+unsigned long allocation_count();
+
+}
+
+#endif /* ALLOCATIONCOUNTER_H_ */
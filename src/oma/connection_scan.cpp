@@ -0,0 +1,361 @@
+/*!
+ * @file connection_scan.cpp
+ * @brief This file contains the implementation of the connection scan timetable engine.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <algorithm>
+
+#include "tbb/parallel_sort.h"
+
+#include "connection_scan.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// Orders connections by departure time.
+static bool departs_before(const Connection &c1, const Connection &c2)
+{
+	return c1.departure < c2.departure;
+}
+
+/// Orders connection indices by arrival time.
+class ArrivesBefore
+{
+private:
+	const vector<Connection> *connections;
+
+public:
+	ArrivesBefore(const vector<Connection> *c) :
+			connections(c)
+	{
+	}
+
+	bool operator()(unsigned int i, unsigned int j) const
+	{
+		return (*connections)[i].arrival < (*connections)[j].arrival;
+	}
+};
+
+/**
+ * This constructor flattens the flight graph into one big array of connections
+ * and sorts it by departure time. An additional index sorted by arrival time is
+ * built, too. This is needed, because the arrivals have to be processed in
+ * chronological order during the scan.
+ */
+oma::ConnectionScan::ConnectionScan(concurrent_hash_map<string, Location> *lm,
+		unsigned long ml)
+{
+	max_layover_time = ml;
+
+	concurrent_hash_map<string, Location>::iterator i;
+	for (i = lm->begin(); i != lm->end(); ++i)
+	{
+		cities.insert(make_pair(i->first, (unsigned int) cities.size()));
+	}
+
+	for (i = lm->begin(); i != lm->end(); ++i)
+	{
+		unsigned int from = cities[i->first];
+		unsigned int s = i->second.outgoing_flights.size();
+		for (unsigned int j = 0; j < s; j++)
+		{
+			const Flight *f = &(i->second.outgoing_flights[j]);
+
+			Connection c;
+			c.departure = f->take_off_time;
+			c.arrival = f->land_time;
+			c.from = from;
+			c.to = cities[f->to];
+			c.flight = f;
+
+			connections.push_back(c);
+		}
+	}
+
+	parallel_sort(connections.begin(), connections.end(), departs_before);
+
+	arrival_order.resize(connections.size());
+	for (unsigned int j = 0; j < connections.size(); j++)
+	{
+		arrival_order[j] = j;
+	}
+
+	parallel_sort(arrival_order.begin(), arrival_order.end(), ArrivesBefore(&connections));
+}
+
+bool oma::ConnectionScan::find_city(const string &city, unsigned int *i) const
+{
+	map<string, unsigned int>::const_iterator it = cities.find(city);
+	if (it == cities.end())
+	{
+		return false;
+	}
+
+	*i = it->second;
+	return true;
+}
+
+/**
+ * This method scans all connections within the time window in chronological
+ * order. Departures and arrivals are processed as two interleaved event streams:
+ * before a connection's departure is processed, all arrivals that happen
+ * strictly before it have already been processed.
+ *
+ * This way, it is sufficient to store only the LATEST arrival time at each city.
+ * A connection can be reached if it starts at the origin or if the latest arrival
+ * at its city of departure lies within the maximum layover time. Since arrivals
+ * are processed in chronological order, the first reached arrival at the
+ * destination is also the earliest one.
+ */
+unsigned long oma::ConnectionScan::earliest_arrival(const string &from, const string &to,
+		unsigned long t_min, unsigned long t_max) const
+{
+	unsigned int s, d;
+	if (!find_city(from, &s) || !find_city(to, &d) || s == d)
+	{
+		return NOT_REACHABLE;
+	}
+
+	vector<unsigned long> last_arrival(cities.size(), NOT_REACHABLE);
+	vector<unsigned char> reached(connections.size(), 0);
+
+	Connection first;
+	first.departure = t_min;
+
+	unsigned int i = lower_bound(connections.begin(), connections.end(), first,
+			departs_before) - connections.begin();
+	unsigned int j = 0, m = connections.size();
+
+	// Skip all arrivals that happen before the time window. These cannot be
+	// reached, anyway.
+	while (j < m && connections[arrival_order[j]].arrival < t_min)
+	{
+		j++;
+	}
+
+	for (; i < m && connections[i].departure <= t_max; i++)
+	{
+		const Connection *c = &(connections[i]);
+
+		for (; j < m && connections[arrival_order[j]].arrival < c->departure; j++)
+		{
+			const Connection *a = &(connections[arrival_order[j]]);
+			if (reached[arrival_order[j]])
+			{
+				if (a->to == d) return a->arrival;
+				last_arrival[a->to] = a->arrival;
+			}
+		}
+
+		if (c->arrival <= t_max
+				&& (c->from == s
+						|| (last_arrival[c->from] != NOT_REACHABLE
+								&& c->departure - last_arrival[c->from]
+										<= max_layover_time)))
+		{
+			reached[i] = 1;
+		}
+	}
+
+	// No more departures within the time window. The remaining arrivals still
+	// need to be checked for the destination.
+	for (; j < m && connections[arrival_order[j]].arrival <= t_max; j++)
+	{
+		if (reached[arrival_order[j]] && connections[arrival_order[j]].to == d)
+		{
+			return connections[arrival_order[j]].arrival;
+		}
+	}
+
+	return NOT_REACHABLE;
+}
+
+bool oma::ConnectionScan::reachable(const string &from, const string &to,
+		unsigned long t_min, unsigned long t_max) const
+{
+	return earliest_arrival(from, to, t_min, t_max) != NOT_REACHABLE;
+}
+
+/**
+ * This method scans all connections within the time window in REVERSE
+ * chronological order and computes the earliest arrival at the destination
+ * for each connection (i.e. when taking this connection). Because connections
+ * are scanned backwards, all possible follow-up connections of a connection
+ * have already been evaluated.
+ *
+ * For each city, the evaluated departures are stored in descending order. The
+ * possible follow-up connections of a connection are found by binary search
+ * on these lists (they need to depart within the maximum layover time).
+ */
+void oma::ConnectionScan::profile(const string &from, const string &to,
+		unsigned long t_min, unsigned long t_max, Profile *profile) const
+{
+	unsigned int s, d;
+	if (!find_city(from, &s) || !find_city(to, &d) || s == d)
+	{
+		return;
+	}
+
+	vector<Profile> departures(cities.size());
+	Profile candidates;
+
+	Connection last;
+	last.departure = t_max;
+
+	int i = upper_bound(connections.begin(), connections.end(), last, departs_before)
+			- connections.begin() - 1;
+
+	for (; i >= 0 && connections[i].departure >= t_min; i--)
+	{
+		const Connection *c = &(connections[i]);
+		unsigned long ea = NOT_REACHABLE;
+
+		if (c->arrival > t_max)
+		{
+			continue;
+		}
+		else if (c->to == d)
+		{
+			ea = c->arrival;
+		}
+		else
+		{
+			// Departures of the follow-up city are sorted in descending order. Search
+			// for all departures within ]arrival, arrival + max_layover].
+			const Profile *next = &(departures[c->to]);
+			unsigned int lo = 0, hi = next->size();
+			while (lo < hi)
+			{
+				unsigned int mid = (lo + hi) / 2;
+				if ((*next)[mid].departure > c->arrival + max_layover_time) lo = mid + 1;
+				else hi = mid;
+			}
+
+			for (unsigned int k = lo;
+					k < next->size() && (*next)[k].departure > c->arrival; k++)
+			{
+				ea = min(ea, (*next)[k].arrival);
+			}
+		}
+
+		if (ea == NOT_REACHABLE)
+		{
+			continue;
+		}
+
+		ProfileEntry e;
+		e.departure = c->departure;
+		e.arrival = ea;
+
+		departures[c->from].push_back(e);
+		if (c->from == s)
+		{
+			candidates.push_back(e);
+		}
+	}
+
+	// Candidates are sorted by descending departure time. Keep only those entries
+	// that arrive earlier than every later departure.
+	unsigned long best = NOT_REACHABLE;
+	for (unsigned int k = 0; k < candidates.size(); k++)
+	{
+		if (candidates[k].arrival < best)
+		{
+			best = candidates[k].arrival;
+
+			if (!profile->empty() && profile->back().departure == candidates[k].departure)
+			{
+				profile->back() = candidates[k];
+			}
+			else
+			{
+				profile->push_back(candidates[k]);
+			}
+		}
+	}
+
+	reverse(profile->begin(), profile->end());
+}
+
+/**
+ * This method scans all connections within the time window in REVERSE
+ * chronological order. All follow-up connections of a connection depart after it,
+ * so the latest departures of its city of arrival are already known.
+ */
+void oma::ConnectionScan::latest_departures(const string &to, unsigned long t_min,
+		unsigned long t_max, vector<unsigned long> *out) const
+{
+	out->assign(cities.size(), 0);
+
+	unsigned int d;
+	if (!find_city(to, &d))
+	{
+		return;
+	}
+	(*out)[d] = NOT_REACHABLE;
+
+	Connection last;
+	last.departure = t_max;
+
+	int i = upper_bound(connections.begin(), connections.end(), last, departs_before)
+			- connections.begin() - 1;
+
+	for (; i >= 0 && connections[i].departure >= t_min; i--)
+	{
+		const Connection *c = &(connections[i]);
+		if (c->arrival <= t_max && (*out)[c->to] > c->arrival
+				&& (*out)[c->from] < c->departure)
+		{
+			(*out)[c->from] = c->departure;
+		}
+	}
+}
+
+/**
+ * This method scans all connections within the time window in chronological
+ * order. All connections that arrive at a city before a connection departs from
+ * it have departed earlier, so the earliest arrival at its city of departure is
+ * already known.
+ */
+void oma::ConnectionScan::earliest_arrivals(const string &from, unsigned long t_min,
+		unsigned long t_max, vector<unsigned long> *out) const
+{
+	out->assign(cities.size(), NOT_REACHABLE);
+
+	unsigned int s;
+	if (!find_city(from, &s))
+	{
+		return;
+	}
+	(*out)[s] = 0;
+
+	Connection first;
+	first.departure = t_min;
+
+	unsigned int i = lower_bound(connections.begin(), connections.end(), first,
+			departs_before) - connections.begin();
+
+	for (; i < connections.size() && connections[i].departure <= t_max; i++)
+	{
+		const Connection *c = &(connections[i]);
+		if (c->arrival <= t_max && (*out)[c->from] < c->departure
+				&& (*out)[c->to] > c->arrival)
+		{
+			(*out)[c->to] = c->arrival;
+		}
+	}
+}
+
+int oma::ConnectionScan::city_index(const string &city) const
+{
+	unsigned int i;
+	return find_city(city, &i) ? (int) i : -1;
+}
+
+unsigned int oma::ConnectionScan::size() const
+{
+	return connections.size();
+}
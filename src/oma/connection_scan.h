@@ -0,0 +1,154 @@
+/*!
+ * @file connection_scan.h
+ * @brief This file contains declarations for the connection scan timetable engine.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef CONNECTIONSCAN_H_
+#define CONNECTIONSCAN_H_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <limits>
+#include "tbb/concurrent_hash_map.h"
+
+#include "../types.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// Marks a location as not reachable.
+const unsigned long NOT_REACHABLE = numeric_limits<unsigned long>::max();
+
+/// A single elementary connection (i.e. one flight) of the timetable.
+/** Connections store city indices instead of names, so that a scan only
+ *  touches this compact array and some small per-city arrays. */
+struct Connection
+{
+	unsigned long departure;/*!< Take off time (epoch). */
+	unsigned long arrival;/*!< Land time (epoch). */
+	unsigned int from;/*!< Index of the city where the flight takes off. */
+	unsigned int to;/*!< Index of the city where the flight lands. */
+	const Flight *flight;/*!< The original flight. */
+};
+
+/// A single entry of a departure profile.
+struct ProfileEntry
+{
+	unsigned long departure;/*!< Departure time at the origin (epoch). */
+	unsigned long arrival;/*!< Earliest arrival time at the destination (epoch). */
+};
+
+typedef vector<ProfileEntry> Profile;
+
+/// Answers earliest arrival and profile queries on the flight timetable.
+/** This class implements the "Connection Scan Algorithm". All flights of
+ *  the flight graph are sorted by take off time ONCE (after parsing). Queries
+ *  are then answered by a single linear scan over this sorted array.
+ *
+ *  Connections are subject to the same side conditions as in the route
+ *  search: all flights must take off and land within the given time window,
+ *  and the layover between two flights must not exceed the maximum layover
+ *  time (the first flight of a route is not subject to layover restrictions).
+ *
+ *  Since the scan does not care about cities visited twice, its results are
+ *  optimistic. This makes it suitable as a pruning oracle for the route search:
+ *  if the scan cannot find a connection, the route search won't find one either. */
+class ConnectionScan
+{
+private:
+	/// All connections, sorted by departure time.
+	vector<Connection> connections;
+
+	/// Indices into "connections", sorted by arrival time.
+	vector<unsigned int> arrival_order;
+
+	/// Maps city names to city indices.
+	map<string, unsigned int> cities;
+
+	/// Maximum layover time between two flights.
+	unsigned long max_layover_time;
+
+	/// Looks up a city index.
+	/** @param city The city name.
+	 *  @param i    Output city index.
+	 *  @return     TRUE if the city is known. */
+	bool find_city(const string &city, unsigned int *i) const;
+
+public:
+	/// Builds the timetable from the flight graph.
+	/** @param lm The location map (must not be modified anymore).
+	 *  @param ml Maximum layover time (in seconds). */
+	ConnectionScan(tbb::concurrent_hash_map<string, Location> *lm, unsigned long ml);
+
+	/// Computes the earliest possible arrival time at a destination.
+	/** @param from  The origin.
+	 *  @param to    The destination.
+	 *  @param t_min You must not be in a plane before this value (epoch).
+	 *  @param t_max You must not be in a plane after this value (epoch).
+	 *  @return      The earliest arrival time, or NOT_REACHABLE. */
+	unsigned long earliest_arrival(const string &from, const string &to,
+			unsigned long t_min, unsigned long t_max) const;
+
+	/// Tests if a destination can be reached at all.
+	/** @see earliest_arrival */
+	bool reachable(const string &from, const string &to, unsigned long t_min,
+			unsigned long t_max) const;
+
+	/// Computes the latest departure from each city that still reaches a destination.
+	/** The maximum layover time is ignored, so the result is optimistic: a route
+	 *  that arrives at a city at or after the city's latest departure cannot
+	 *  reach the destination anymore.
+	 *
+	 *  @param to    The destination.
+	 *  @param t_min You must not be in a plane before this value (epoch).
+	 *  @param t_max You must not be in a plane after this value (epoch).
+	 *  @param out   Output vector, indexed by city (see "city_index"). Cities that
+	 *               cannot reach the destination get 0, the destination itself
+	 *               gets NOT_REACHABLE (i.e. it can be left at any time). */
+	void latest_departures(const string &to, unsigned long t_min, unsigned long t_max,
+			vector<unsigned long> *out) const;
+
+	/// Computes the earliest arrival at each city from an origin.
+	/** This is the counterpart of "latest_departures" for backward searches: a
+	 *  route that leaves a city at or before the city's earliest arrival cannot
+	 *  be reached from the origin.
+	 *
+	 *  @param from  The origin.
+	 *  @param t_min You must not be in a plane before this value (epoch).
+	 *  @param t_max You must not be in a plane after this value (epoch).
+	 *  @param out   Output vector, indexed by city (see "city_index"). Cities that
+	 *               cannot be reached get NOT_REACHABLE, the origin itself gets 0. */
+	void earliest_arrivals(const string &from, unsigned long t_min, unsigned long t_max,
+			vector<unsigned long> *out) const;
+
+	/// Looks up the index of a city.
+	/** @param city The city name.
+	 *  @return     The city index, or -1 if the city is unknown. */
+	int city_index(const string &city) const;
+
+	/// Computes the departure profile between two cities.
+	/** The profile contains the earliest arrival time at the destination for
+	 *  every relevant departure time at the origin. Entries that are dominated
+	 *  (i.e. a later departure arrives not later) are omitted. Entries are
+	 *  sorted by departure time.
+	 *
+	 *  @param from    The origin.
+	 *  @param to      The destination.
+	 *  @param t_min   You must not be in a plane before this value (epoch).
+	 *  @param t_max   You must not be in a plane after this value (epoch).
+	 *  @param profile Output profile. */
+	void profile(const string &from, const string &to, unsigned long t_min,
+			unsigned long t_max, Profile *profile) const;
+
+	/// Gets the number of connections in the timetable.
+	unsigned int size() const;
+};
+
+}
+
+#endif /* CONNECTIONSCAN_H_ */
@@ -7,8 +7,12 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <iterator>
+#include <utility>
 #include "../methods.h"
 #include "loop_bodies.h"
+#include "stats.h"
+#include "tracer.h"
 
 #include "tbb/concurrent_hash_map.h"
 
@@ -23,6 +27,8 @@ oma::ParseFlightsLoop::ParseFlightsLoop(char* i, vector<int>* l, Parameters *p)
 
 void oma::ParseFlightsLoop::operator()(const blocked_range<int> range) const
 {
+	TraceScope trace("ParseFlightsLoop", range.size());
+
 	for (int i = range.begin(); i != range.end(); ++i)
 	{
 		// Determine the length of the line by computing the difference between the
@@ -37,8 +43,8 @@ void oma::ParseFlightsLoop::operator()(const blocked_range<int> range) const
 		// Add 0-byte to mark string end.
 		b[lfs->at(i) - lfs->at(i - 1) - 1] = 0x00;
 
-		// Parse line.
-		parse_flight(b, parameters);
+		// Parse line. Line i contains the flight with index i - 1.
+		parse_flight(b, i - 1, parameters);
 	}
 }
 
@@ -60,8 +66,11 @@ oma::PathMergingOuterLoop::PathMergingOuterLoop(PathMergingOuterLoop &pmol, spli
 
 void oma::PathMergingOuterLoop::operator()(blocked_range2d<unsigned int, unsigned int> &range)
 {
-	Travel *t1, *t2, *tf;
-	Flight *l1, *f2;
+	Travel *t1, *t2;
+	const Flight *l1, *f2;
+
+	TraceScope trace("PathMergingOuterLoop", range.rows().size() * range.cols().size());
+	stats_counters().merge_pairs += range.rows().size() * range.cols().size();
 
 	for (unsigned int i = range.rows().begin(); i != range.rows().end(); ++i)
 	{
@@ -69,23 +78,21 @@ void oma::PathMergingOuterLoop::operator()(blocked_range2d<unsigned int, unsigne
 		for (unsigned int j = range.cols().begin(); j != range.cols().end(); ++j)
 		{
 			t2 = &(travels2->at(j));
-			l1 = &(t1->flights.back());
-			f2 = &(t2->flights.front());
+			l1 = &(t1->last_flight());
+			f2 = &(t2->first_flight());
 			if (l1->land_time < f2->take_off_time
 					&& t1->min_cost + t2->min_cost <= min_range.max)
 			{
-				tf = new Travel(*t1);
-				tf->merge_travel(t2, alliances);
+				// Assigning reuses the scratch travel's memory.
+				candidate = *t1;
+				candidate.merge_travel(t2, alliances);
 
-				min_range.from_travel(tf);
+				min_range.from_travel(&candidate);
 
-				if (cheapest == NULL || tf->max_cost < cheapest->max_cost)
+				if (cheapest == NULL || candidate.better_than(*cheapest))
 				{
-					cheapest = tf;
-				}
-				else
-				{
-					delete tf;
+					swap(best, candidate);
+					cheapest = &best;
 				}
 			}
 		}
@@ -94,9 +101,11 @@ void oma::PathMergingOuterLoop::operator()(blocked_range2d<unsigned int, unsigne
 
 void oma::PathMergingOuterLoop::join(PathMergingOuterLoop &pmol)
 {
-	if (pmol.cheapest != NULL && pmol.cheapest->max_cost < cheapest->max_cost)
+	if (pmol.cheapest != NULL
+			&& (cheapest == NULL || pmol.cheapest->better_than(*cheapest)))
 	{
-		cheapest = pmol.cheapest;
+		swap(best, pmol.best);
+		cheapest = &best;
 	}
 }
 
@@ -128,8 +137,12 @@ oma::PathMergingTripleOuterLoop::PathMergingTripleOuterLoop(
 void oma::PathMergingTripleOuterLoop::operator()(
 		blocked_range3d<unsigned int, unsigned int, unsigned int> &range)
 {
-	Travel *t1, *t2, *t3, *t12, *tf;
-	Flight *l1, *l2, *f2, *f3;
+	Travel *t1, *t2, *t3;
+	const Flight *l1, *l2, *f2, *f3;
+	unsigned long pairs = 0;
+
+	TraceScope trace("PathMergingTripleOuterLoop",
+			range.pages().size() * range.rows().size() * range.cols().size());
 
 	for (unsigned int i = range.pages().begin(); i != range.pages().end(); ++i)
 	{
@@ -137,51 +150,52 @@ void oma::PathMergingTripleOuterLoop::operator()(
 		for (unsigned int j = range.rows().begin(); j != range.rows().end(); ++j)
 		{
 			t2 = &(travels2->at(j));
+			pairs++;
 
-			l1 = &(t1->flights.back());
-			f2 = &(t2->flights.front());
+			l1 = &(t1->last_flight());
+			f2 = &(t2->first_flight());
 
 			if (l1->land_time < f2->take_off_time)
 			{
-				t12 = new Travel(*t1);
-				t12->merge_travel(t2, alliances);
+				partial = *t1;
+				partial.merge_travel(t2, alliances);
 
 				for (unsigned int k = range.cols().begin(); k != range.cols().end(); ++k)
 				{
 					t3 = &(travels3->at(k));
+					pairs++;
 
-					l2 = &(t2->flights.back());
-					f3 = &(t3->flights.front());
+					l2 = &(t2->last_flight());
+					f3 = &(t3->first_flight());
 
 					if (l2->land_time < f3->take_off_time
-							&& t12->min_cost + t3->min_cost <= min_range.max)
+							&& partial.min_cost + t3->min_cost <= min_range.max)
 					{
-						tf = new Travel(*t12);
-						tf->merge_travel(t3, alliances);
-						min_range.from_travel(tf);
+						candidate = partial;
+						candidate.merge_travel(t3, alliances);
+						min_range.from_travel(&candidate);
 
-						if (cheapest == NULL || tf->max_cost < cheapest->max_cost)
+						if (cheapest == NULL || candidate.better_than(*cheapest))
 						{
-							cheapest = tf;
-						}
-						else
-						{
-							delete tf;
+							swap(best, candidate);
+							cheapest = &best;
 						}
 					}
 				}
-
-				delete t12;
 			}
 		}
 	}
+
+	stats_counters().merge_pairs += pairs;
 }
 
 void oma::PathMergingTripleOuterLoop::join(PathMergingTripleOuterLoop &pmol)
 {
-	if (pmol.cheapest != NULL && pmol.cheapest->max_cost < cheapest->max_cost)
+	if (pmol.cheapest != NULL
+			&& (cheapest == NULL || pmol.cheapest->better_than(*cheapest)))
 	{
-		cheapest = pmol.cheapest;
+		swap(best, pmol.best);
+		cheapest = &best;
 	}
 }
 
@@ -201,22 +215,86 @@ oma::FilterPathsLoop::FilterPathsLoop(FilterPathsLoop &fpl, split)
 {
 	in = fpl.in;
 	range = fpl.range;
-	out = new Travels;
+	out = &local;
 }
 
 void oma::FilterPathsLoop::operator ()(blocked_range<unsigned int> r)
 {
+	TraceScope trace("FilterPathsLoop", r.size());
+
 	for (unsigned int i = r.begin(); i != r.end(); ++i)
 	{
 		if ((&(in->at(i)))->min_cost <= range->max)
 		{
-			out->push_back(in->at(i));
+			out->push_back(std::move(in->at(i)));
 		}
 	}
 }
 
 void oma::FilterPathsLoop::join(FilterPathsLoop &fpl)
 {
-	out->insert(out->end(), fpl.out->begin(), fpl.out->end());
-	delete fpl.out;
+	out->insert(out->end(), make_move_iterator(fpl.out->begin()),
+			make_move_iterator(fpl.out->end()));
+}
+
+oma::MeetInTheMiddleLoop::MeetInTheMiddleLoop(vector<string> *c, RoutesByCity *fw,
+		RoutesByCity *bw, PathTargets *dst, unsigned long ml, unsigned int mh, Alliances *a)
+{
+	cities = c;
+	forward = fw;
+	backward = bw;
+	targets = dst;
+	max_layover_time = ml;
+	max_hops = mh;
+	alliances = a;
+}
+
+void oma::MeetInTheMiddleLoop::operator ()(const blocked_range<unsigned int> r) const
+{
+	unsigned long pairs = 0;
+	TraceScope trace("MeetInTheMiddleLoop", r.size());
+
+	for (unsigned int i = r.begin(); i != r.end(); ++i)
+	{
+		Travels *t1 = &(forward->find(cities->at(i))->second);
+		Travels *t2 = &(backward->find(cities->at(i))->second);
+
+		for (unsigned int j = 0; j < t1->size(); j++)
+		{
+			Travel *fw = &(t1->at(j));
+			const Flight *l = &(fw->last_flight());
+
+			for (unsigned int k = 0; k < t2->size(); k++)
+			{
+				Travel *bw = &(t2->at(k));
+				const Flight *f = &(bw->first_flight());
+				pairs++;
+
+				if ((fw->size() != bw->size() && fw->size() != bw->size() + 1)
+						|| (max_hops > 0 && fw->size() + bw->size() > max_hops)
+						|| f->take_off_time <= l->land_time
+						|| f->take_off_time - l->land_time > max_layover_time
+						|| fw->min_cost + bw->min_cost > targets->ranges[0].max)
+				{
+					continue;
+				}
+
+				bool disjoint = true;
+				for (unsigned int m = 0; m < bw->flights.size() && disjoint; m++)
+				{
+					disjoint = nerver_traveled_to(*fw, bw->flight(m).to);
+				}
+
+				if (disjoint)
+				{
+					Travel t = *fw;
+					t.merge_travel(bw, alliances);
+
+					targets->move_travel(0, &t);
+				}
+			}
+		}
+	}
+
+	stats_counters().merge_pairs += pairs;
 }
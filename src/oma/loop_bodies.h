@@ -12,10 +12,10 @@
 #include "tbb/blocked_range.h"
 #include "tbb/blocked_range2d.h"
 #include "tbb/blocked_range3d.h"
-#include "tbb/mutex.h"
-#include "tbb/parallel_do.h"
+#include "tbb/spin_mutex.h"
 #include "tbb/concurrent_hash_map.h"
 #include "../types.h"
+#include "route_store.h"
 
 using namespace std;
 using namespace tbb;
@@ -54,7 +54,9 @@ public:
  *  travels in vector a and all travels in vector b (assuming the landing time
  *  of the last flight in a and the takeoff time of the first flight in b match).
  *
- *  This loop also determines the cheapest route on-the-fly. */
+ *  This loop also determines the cheapest route on-the-fly. The combinations
+ *  are built in a scratch travel that is reused, so that no travel needs to be
+ *  allocated per combination. */
 class PathMergingOuterLoop
 {
 protected:
@@ -63,6 +65,12 @@ protected:
 	Travel *cheapest;
 	CostRange min_range;
 
+	/// The cheapest combination found so far ("cheapest" points here).
+	Travel best;
+
+	/// Scratch travel for the combination under test.
+	Travel candidate;
+
 public:
 
 	/// Initial constructor.
@@ -93,7 +101,8 @@ public:
  *  travels in vector a, b and c (assuming the landing time
  *  of the last flight in {a,b} and the takeoff time of the first flight in {b,c} match).
  *
- *  This loop also determines the cheapest route on-the-fly. */
+ *  This loop also determines the cheapest route on-the-fly. Like in
+ *  "PathMergingOuterLoop", the combinations are built in reused scratch travels. */
 class PathMergingTripleOuterLoop
 {
 protected:
@@ -102,6 +111,13 @@ protected:
 	Travel *cheapest;
 	CostRange min_range;
 
+	/// The cheapest combination found so far ("cheapest" points here).
+	Travel best;
+
+	/// Scratch travels for the combination of the first two routes and for the
+	/// combination under test.
+	Travel partial, candidate;
+
 public:
 
 	/// Initial constructor.
@@ -131,13 +147,17 @@ public:
 /** This loop body filters a set of travels by a predefined minimal cost.
  *  It takes an input vector "in" and a "CostRange" object pointer as arguments and
  *  fills its output vector "out" with all travels from "in" that are possibly
- *  cheaper than defined by the cost range. */
+ *  cheaper than defined by the cost range. The travels are moved, not copied,
+ *  so the input vector contains empty travels afterwards. */
 class FilterPathsLoop
 {
 private:
 	Travels *in, *out;
 	CostRange *range;
 
+	/// Output vector of split loop bodies.
+	Travels local;
+
 public:
 	/// Initial constructor.
 	/** @param i Input vector.
@@ -158,6 +178,42 @@ public:
 	void join(FilterPathsLoop &fpl);
 };
 
+/// Loop body for joining the results of a bidirectional search.
+/** This loop body joins the routes of a forward search and a backward search
+ *  at each city where both searches met. Two routes are joined if the layover
+ *  time between them is within the maximum layover time and if they do not
+ *  share any other city.
+ *
+ *  Each route must be found only once. A route of n flights is therefore only
+ *  built from a forward route with ceil(n/2) flights and a backward route with
+ *  floor(n/2) flights. */
+class MeetInTheMiddleLoop
+{
+private:
+	vector<string> *cities;
+	RoutesByCity *forward, *backward;
+	PathTargets *targets;
+	unsigned long max_layover_time;
+	unsigned int max_hops;
+	Alliances *alliances;
+
+public:
+	/// Initial constructor.
+	/** @param c   Cities where both searches met.
+	 *  @param fw  Routes of the forward search.
+	 *  @param bw  Routes of the backward search.
+	 *  @param dst Destination of the search (joined routes are stored here).
+	 *  @param ml  Maximum layover time.
+	 *  @param mh  Maximum number of flights of a joined route (0 = unlimited).
+	 *  @param a   Alliance list. */
+	MeetInTheMiddleLoop(vector<string> *c, RoutesByCity *fw, RoutesByCity *bw,
+			PathTargets *dst, unsigned long ml, unsigned int mh, Alliances *a);
+
+	/// Loop body.
+	/** @param r Range to be iterated over. */
+	void operator()(const blocked_range<unsigned int> r) const;
+};
+
 }
 
 #endif /* LOOPBODIES_H_ */
@@ -0,0 +1,120 @@
+/*!
+ * @file numa.cpp
+ * @brief This file contains the implementation of the NUMA nodes.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <vector>
+#include "tbb/info.h"
+#include "tbb/task_scheduler_observer.h"
+
+#include "numa.h"
+#include "perf_counters.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// All NUMA nodes.
+static vector<NumaNode> nodes;
+
+/// Copies the flight graph and the flight table.
+/** This is run in the arena of a NUMA node, so that the copies are allocated in
+ *  the node's memory. */
+class CopyGraph
+{
+private:
+	concurrent_hash_map<string, Location> *source;
+	NumaNode *node;
+
+public:
+	/// Creates a new copy task.
+	/** @param s The flight graph.
+	 *  @param n The node that receives the copies. */
+	CopyGraph(concurrent_hash_map<string, Location> *s, NumaNode *n) :
+			source(s), node(n)
+	{
+	}
+
+	/// Copies the flight graph and the flight table.
+	void operator()() const
+	{
+		node->location_map = new concurrent_hash_map<string, Location>(*source);
+		node->flight_table = new vector<Flight>(Travel::flight_table);
+	}
+};
+
+/// Makes the threads of a NUMA node's arena read the node's flight table.
+/** Threads that leave the arena fall back to the original flight table. */
+class FlightTableObserver: public task_scheduler_observer
+{
+private:
+	const Flight *table;
+
+public:
+	/// Observes the arena of a node.
+	/** @param a The node's arena.
+	 *  @param t The node's flight table. */
+	FlightTableObserver(task_arena &a, const Flight *t) :
+			task_scheduler_observer(a), table(t)
+	{
+	}
+
+	void on_scheduler_entry(bool) override
+	{
+		Travel::node_flight_table = table;
+	}
+
+	void on_scheduler_exit(bool) override
+	{
+		Travel::node_flight_table = NULL;
+	}
+};
+
+/** The nodes are set up only once. */
+unsigned int oma::init_numa_nodes(concurrent_hash_map<string, Location> *lm, bool replicate)
+{
+	if (nodes.size() > 0)
+	{
+		return nodes.size();
+	}
+
+	vector<numa_node_id> ids;
+	if (replicate)
+	{
+		ids = info::numa_nodes();
+	}
+
+	// Without topology information, TBB reports a single node with the id -1.
+	if (ids.size() < 2)
+	{
+		NumaNode n;
+		n.arena = NULL;
+		n.location_map = lm;
+		n.flight_table = &Travel::flight_table;
+		nodes.push_back(n);
+		return 1;
+	}
+
+	for (unsigned int i = 0; i < ids.size(); i++)
+	{
+		NumaNode n;
+		n.arena = new task_arena(task_arena::constraints(ids[i]));
+		n.arena->initialize();
+		n.arena->execute(CopyGraph(lm, &n));
+		observe_perf_counters(*n.arena);
+
+		// Like the nodes, the observers are never destroyed.
+		FlightTableObserver *o = new FlightTableObserver(*n.arena, n.flight_table->data());
+		o->observe(true);
+		nodes.push_back(n);
+	}
+
+	return nodes.size();
+}
+
+const NumaNode &oma::numa_node(unsigned int i)
+{
+	return nodes[i % nodes.size()];
+}
@@ -0,0 +1,59 @@
+/*!
+ * @file numa.h
+ * @brief This file contains declarations for running route searches on NUMA nodes.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <string>
+#include "tbb/task_arena.h"
+#include "tbb/concurrent_hash_map.h"
+
+#include "../types.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// A NUMA node on which route searches are run.
+struct NumaNode
+{
+	/// Arena whose threads are pinned to this node (NULL = the default arena).
+	tbb::task_arena *arena;
+
+	/// The flight graph, stored in the memory of this node.
+	tbb::concurrent_hash_map<string, Location> *location_map;
+
+	/// The flight table (see "Travel::flight_table"), stored in the memory of this node.
+	vector<Flight> *flight_table;
+};
+
+/// Sets up the NUMA nodes on which route searches are run.
+/** If "replicate" is set and the machine has more than one NUMA node, one task
+ *  arena is created per node, whose threads are pinned to the node. Each node
+ *  gets its own copies of the (read-only) flight graph and flight table. The
+ *  copies are made by a thread of the node, so that their memory is allocated
+ *  on the node. Threads read the flight table of their node while they are in
+ *  its arena (see "Travel::node_flight_table").
+ *
+ *  Otherwise (or if TBB cannot determine the machine's topology), a single node
+ *  is used, which consists of the default arena and the original flight graph.
+ *
+ *  @param lm        The flight graph.
+ *  @param replicate TRUE if the flight graph should be replicated.
+ *  @return          The number of nodes. */
+unsigned int init_numa_nodes(tbb::concurrent_hash_map<string, Location> *lm, bool replicate);
+
+/// Gets a NUMA node.
+/** @param i Any number. The nodes are assigned round robin, i.e. node "i" modulo
+ *           the number of nodes is returned.
+ *  @return  The node. */
+const NumaNode &numa_node(unsigned int i);
+
+}
+
+#endif /* NUMA_H_ */
@@ -0,0 +1,231 @@
+/*!
+ * @file perf_counters.cpp
+ * @brief This file contains the implementation of hardware performance counters.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include "tbb/spin_mutex.h"
+#include "tbb/task_scheduler_observer.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perf_counters.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// Group leader file descriptors of the counters of all threads.
+static vector<int> groups;
+
+/// Protects the group list.
+static spin_mutex groups_lock;
+
+/// TRUE if counters are enabled.
+static bool enabled = false;
+
+/// TRUE if the counters of the calling thread have been opened.
+static thread_local bool thread_opened = false;
+
+static const char *event_names[PERF_EVENTS] =
+{ "cycles", "instructions", "cache_misses", "branch_misses" };
+
+oma::PerfValues::PerfValues()
+{
+	for (unsigned int i = 0; i < PERF_EVENTS; i++)
+	{
+		values[i] = 0;
+	}
+}
+
+PerfValues &oma::PerfValues::operator+=(const PerfValues &v)
+{
+	for (unsigned int i = 0; i < PERF_EVENTS; i++)
+	{
+		values[i] += v.values[i];
+	}
+	return *this;
+}
+
+PerfValues &oma::PerfValues::operator-=(const PerfValues &v)
+{
+	for (unsigned int i = 0; i < PERF_EVENTS; i++)
+	{
+		values[i] -= v.values[i];
+	}
+	return *this;
+}
+
+/// Opens the counters of the calling thread as one group.
+/** All events of a group are scheduled onto the PMU together, so that their
+ *  values refer to the same time (e.g. for computing instructions per cycle).
+ *
+ *  @return The file descriptor of the group leader, or -1 on error (see errno). */
+static int open_group()
+{
+#ifdef __linux__
+	static const unsigned long long configs[PERF_EVENTS] =
+	{ PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES };
+
+	int leader = -1;
+	for (unsigned int i = 0; i < PERF_EVENTS; i++)
+	{
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+		if (fd < 0)
+		{
+			// Closing the leader closes the whole group.
+			int e = errno;
+			if (leader >= 0) close(leader);
+			errno = e;
+			return -1;
+		}
+
+		if (leader < 0) leader = fd;
+	}
+	return leader;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/// Opens the counters of the calling thread (once) and registers them.
+static void open_thread_counters()
+{
+	if (thread_opened)
+	{
+		return;
+	}
+	thread_opened = true;
+
+	int fd = open_group();
+	if (fd >= 0)
+	{
+		spin_mutex::scoped_lock l(groups_lock);
+		groups.push_back(fd);
+	}
+}
+
+/// Opens the counters of each thread that joins the task scheduler.
+class PerfObserver: public task_scheduler_observer
+{
+public:
+	/// Observes the default arena.
+	PerfObserver()
+	{
+	}
+
+	/// Observes another arena.
+	PerfObserver(task_arena &a) :
+			task_scheduler_observer(a)
+	{
+	}
+
+	void on_scheduler_entry(bool) override
+	{
+		open_thread_counters();
+	}
+};
+
+static PerfObserver *observer = NULL;
+
+bool oma::enable_perf_counters()
+{
+	// The calling thread tests if counters are available at all.
+	int fd = open_group();
+	if (fd < 0)
+	{
+		cerr << "Hardware performance counters are not available (" << strerror(errno)
+				<< ")." << endl;
+		return false;
+	}
+
+	thread_opened = true;
+	groups.push_back(fd);
+	enabled = true;
+
+	observer = new PerfObserver;
+	observer->observe(true);
+	return true;
+}
+
+void oma::observe_perf_counters(task_arena &a)
+{
+	if (!enabled)
+	{
+		return;
+	}
+
+	// Observers are never destroyed, since the counters are read until the very end.
+	PerfObserver *o = new PerfObserver(a);
+	o->observe(true);
+}
+
+bool oma::perf_counters_enabled()
+{
+	return enabled;
+}
+
+/// Reads the counters of a group.
+static PerfValues read_group(int fd)
+{
+	PerfValues v;
+	unsigned long long buf[PERF_EVENTS + 1];
+	if (read(fd, buf, sizeof(buf)) == (ssize_t) sizeof(buf))
+	{
+		for (unsigned int i = 0; i < PERF_EVENTS; i++)
+		{
+			v.values[i] = buf[i + 1];
+		}
+	}
+	return v;
+}
+
+/** The counters of threads that have exited keep their last values, so no work
+ *  gets lost. */
+PerfValues oma::read_perf_counters()
+{
+	PerfValues total;
+
+	spin_mutex::scoped_lock l(groups_lock);
+	for (unsigned int i = 0; i < groups.size(); i++)
+	{
+		total += read_group(groups[i]);
+	}
+	return total;
+}
+
+vector<PerfValues> oma::read_thread_perf_counters()
+{
+	vector<PerfValues> v;
+
+	spin_mutex::scoped_lock l(groups_lock);
+	for (unsigned int i = 0; i < groups.size(); i++)
+	{
+		v.push_back(read_group(groups[i]));
+	}
+	return v;
+}
+
+const char *oma::perf_event_name(unsigned int e)
+{
+	return event_names[e];
+}
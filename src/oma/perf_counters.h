@@ -0,0 +1,77 @@
+/*!
+ * @file perf_counters.h
+ * @brief This file contains declarations for hardware performance counters.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <vector>
+#include "tbb/task_arena.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// Hardware events that are counted.
+enum PerfEvent
+{
+	PERF_CYCLES,/*!< CPU cycles. */
+	PERF_INSTRUCTIONS,/*!< Retired instructions. */
+	PERF_CACHE_MISSES,/*!< Last level cache misses. */
+	PERF_BRANCH_MISSES,/*!< Mispredicted branches. */
+	PERF_EVENTS
+};
+
+/// Values of the hardware performance counters.
+struct PerfValues
+{
+	unsigned long long values[PERF_EVENTS];
+
+	/// Creates zero values.
+	PerfValues();
+
+	/// Adds other values.
+	PerfValues &operator+=(const PerfValues &v);
+
+	/// Subtracts other values.
+	PerfValues &operator-=(const PerfValues &v);
+};
+
+/// Starts counting hardware events in all threads.
+/** The counters of each thread are opened with "perf_event_open" when the thread
+ *  joins the task scheduler (and for the calling thread immediately). This
+ *  needs to be called before any parallel work is started.
+ *
+ *  Counters are often not available (e.g. in containers or virtual machines,
+ *  or due to "kernel.perf_event_paranoid"). In this case, nothing is counted.
+ *
+ *  @return FALSE if the counters are not available. */
+bool enable_perf_counters();
+
+/// Counts hardware events in the threads of another task arena.
+/** "enable_perf_counters" only observes the threads that join the default arena.
+ *  Arenas that are created later (e.g. for NUMA nodes) need to be registered
+ *  here. Does nothing if the counters are not enabled.
+ *
+ *  @param a The task arena. */
+void observe_perf_counters(tbb::task_arena &a);
+
+/// Tests if hardware events are counted.
+bool perf_counters_enabled();
+
+/// Reads the counters of all threads and sums them up.
+PerfValues read_perf_counters();
+
+/// Reads the counters of each thread.
+vector<PerfValues> read_thread_perf_counters();
+
+/// Gets the name of an event (e.g. "cycles").
+const char *perf_event_name(unsigned int e);
+
+}
+
+#endif /* PERF_COUNTERS_H_ */
@@ -0,0 +1,383 @@
+/*!
+ * @file route_cache.cpp
+ * @brief This file contains the implementation of the partial route cache.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+#include "route_cache.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// Identifies cache files (followed by the file format version).
+static const char CACHE_MAGIC[8] = { 'O', 'M', 'A', 'R', 'C', 'A', 'C', 'H' };
+static const unsigned int CACHE_FORMAT = 3;
+
+/// Maximum number of cached entries per origin and destination.
+#define CACHE_ENTRIES_PER_PAIR 8
+
+/// Maximum size of a cache file (in bytes).
+#define CACHE_FILE_SIZE (64 * 1024 * 1024)
+
+/// Writes a plain value in binary form.
+template<typename T>
+static void write_value(ostream &out, const T &v)
+{
+	out.write((const char*) &v, sizeof(T));
+}
+
+/// Reads a plain value in binary form.
+template<typename T>
+static bool read_value(istream &in, T *v)
+{
+	in.read((char*) v, sizeof(T));
+	return in.good();
+}
+
+/// Writes a string in binary form (length first).
+static void write_string(ostream &out, const string &s)
+{
+	write_value(out, (unsigned int) s.size());
+	out.write(s.data(), s.size());
+}
+
+/// Reads a string in binary form.
+static bool read_string(istream &in, string *s)
+{
+	unsigned int l;
+	if (!read_value(in, &l)) return false;
+
+	s->resize(l);
+	if (l > 0) in.read(&((*s)[0]), l);
+	return in.good();
+}
+
+/**
+ * Only the flight indices are written, so the travel can only be read again
+ * for the same flights file (which is ensured by the flight data version).
+ */
+void oma::write_travel(ostream &out, const Travel &t)
+{
+	write_value(out, (unsigned int) t.flights.size());
+	for (unsigned int i = 0; i < t.flights.size(); i++)
+	{
+		write_value(out, t.flights[i]);
+		write_value(out, t.discounts[i]);
+	}
+
+	write_value(out, t.min_cost);
+	write_value(out, t.max_cost);
+}
+
+/**
+ * The length is checked before anything is stored, so that a corrupt file cannot
+ * overflow the travel: A route has at least one flight and cannot contain more
+ * flights than there are in the flight table.
+ */
+bool oma::read_travel(istream &in, Travel *t)
+{
+	unsigned int s;
+	if (!read_value(in, &s)) return false;
+
+	if (s == 0 || s > Travel::flight_table.size() || s > t->flights.max_size())
+	{
+		return false;
+	}
+
+	t->flights.resize(s);
+	t->discounts.resize(s);
+
+	for (unsigned int i = 0; i < s; i++)
+	{
+		if (!read_value(in, &(t->flights[i])) || !read_value(in, &(t->discounts[i]))
+				|| t->flights[i] >= Travel::flight_table.size())
+		{
+			return false;
+		}
+	}
+
+	return read_value(in, &(t->min_cost)) && read_value(in, &(t->max_cost));
+}
+
+/// Tests if a cached search covers another search.
+/** @param c The cached search.
+ *  @param k The other search.
+ *  @return  TRUE if both searches have the same limits and the time window of
+ *           the cached search contains the window of the other search. */
+static bool covers(const RouteCacheKey &c, const RouteCacheKey &k)
+{
+	return c.max_layover_time == k.max_layover_time && c.max_hops == k.max_hops
+			&& c.bidirectional_depth == k.bidirectional_depth && c.t_min <= k.t_min
+			&& c.t_max >= k.t_max;
+}
+
+/// Gets the size of an entry in a cache file (in bytes).
+static unsigned long entry_bytes(const RouteCacheEntry &e)
+{
+	unsigned long b = 2 * sizeof(unsigned int) + e.key.from.size() + e.key.to.size()
+			+ 3 * sizeof(unsigned long) + 3 * sizeof(unsigned int);
+
+	for (unsigned int i = 0; i < e.travels.size(); i++)
+	{
+		b += sizeof(unsigned int) + 2 * sizeof(Cost)
+				+ e.travels[i].size() * (sizeof(unsigned int) + sizeof(unsigned char));
+	}
+	return b;
+}
+
+/// Orders cache entries from the most to the least recently used.
+static bool more_recently_used(const RouteCacheEntry *a, const RouteCacheEntry *b)
+{
+	return a->last_used > b->last_used;
+}
+
+oma::RouteCache::RouteCache(unsigned long v)
+{
+	version = v;
+	clock = 0;
+}
+
+bool oma::RouteCache::answer(const RouteCacheEntry &e, const RouteCacheKey &k,
+		Travels *out) const
+{
+	if (!covers(e.key, k))
+	{
+		return false;
+	}
+
+	if (e.key.t_min == k.t_min && e.key.t_max == k.t_max)
+	{
+		out->insert(out->end(), e.travels.begin(), e.travels.end());
+		return true;
+	}
+
+	// Smaller time window: The cheapest route needs to lie within the window,
+	// otherwise the cost bound of a new search would be different.
+	const Travel *cheapest = NULL;
+	for (unsigned int i = 0; i < e.travels.size(); i++)
+	{
+		if (cheapest == NULL || e.travels[i].better_than(*cheapest))
+		{
+			cheapest = &(e.travels[i]);
+		}
+	}
+
+	if (cheapest != NULL
+			&& (cheapest->first_flight().take_off_time < k.t_min
+					|| cheapest->last_flight().land_time > k.t_max))
+	{
+		return false;
+	}
+
+	for (unsigned int i = 0; i < e.travels.size(); i++)
+	{
+		const Travel *t = &(e.travels[i]);
+		if (t->first_flight().take_off_time >= k.t_min
+				&& t->last_flight().land_time <= k.t_max)
+		{
+			out->push_back(*t);
+		}
+	}
+
+	return true;
+}
+
+bool oma::RouteCache::find(const RouteCacheKey &k, Travels *out)
+{
+	spin_mutex::scoped_lock l(lock);
+
+	map<pair<string, string>, vector<RouteCacheEntry> >::iterator i = entries.find(
+			make_pair(k.from, k.to));
+	if (i == entries.end())
+	{
+		return false;
+	}
+
+	for (unsigned int j = 0; j < i->second.size(); j++)
+	{
+		if (answer(i->second[j], k, out))
+		{
+			i->second[j].last_used = ++clock;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Entries that are covered by the new entry are removed, since the new entry
+ * answers the same searches in most cases (see "answer"). If the pair of
+ * locations still has CACHE_ENTRIES_PER_PAIR entries, its least recently used
+ * entry is evicted.
+ */
+void oma::RouteCache::insert(const RouteCacheKey &k, const Travels &t)
+{
+	RouteCacheEntry e;
+	e.key = k;
+	e.travels = t;
+
+	spin_mutex::scoped_lock l(lock);
+	vector<RouteCacheEntry> &v = entries[make_pair(k.from, k.to)];
+
+	for (unsigned int i = 0; i < v.size();)
+	{
+		if (covers(k, v[i].key)) v.erase(v.begin() + i);
+		else i++;
+	}
+
+	if (v.size() >= CACHE_ENTRIES_PER_PAIR)
+	{
+		unsigned int lru = 0;
+		for (unsigned int i = 1; i < v.size(); i++)
+		{
+			if (v[i].last_used < v[lru].last_used) lru = i;
+		}
+		v.erase(v.begin() + lru);
+	}
+
+	e.last_used = ++clock;
+	v.push_back(std::move(e));
+}
+
+/**
+ * The file starts with a magic number, the file format and the flight data
+ * version. If the flight data version does not match, the file's entries are
+ * ignored (but this is not an error).
+ *
+ * The entries are stored from the most to the least recently used one. An entry
+ * is skipped if a more recently used entry of the same locations covers it, or
+ * if its locations already have CACHE_ENTRIES_PER_PAIR entries.
+ */
+bool oma::RouteCache::load(const string &filename)
+{
+	ifstream in(filename.c_str(), ios::in | ios::binary);
+	char magic[8];
+	unsigned int format, n;
+	unsigned long v;
+
+	if (!in.is_open()) return false;
+
+	in.read(magic, sizeof(magic));
+	if (!in.good() || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0
+			|| !read_value(in, &format) || format != CACHE_FORMAT || !read_value(in, &v)
+			|| !read_value(in, &n))
+	{
+		return false;
+	}
+
+	if (v != version) return true;
+
+	for (unsigned int i = 0; i < n; i++)
+	{
+		RouteCacheEntry e;
+		unsigned int s;
+
+		if (!read_string(in, &(e.key.from)) || !read_string(in, &(e.key.to))
+				|| !read_value(in, &(e.key.t_min)) || !read_value(in, &(e.key.t_max))
+				|| !read_value(in, &(e.key.max_layover_time))
+				|| !read_value(in, &(e.key.max_hops))
+				|| !read_value(in, &(e.key.bidirectional_depth)) || !read_value(in, &s))
+		{
+			return false;
+		}
+
+		e.travels.resize(s);
+		for (unsigned int j = 0; j < s; j++)
+		{
+			if (!read_travel(in, &(e.travels[j]))) return false;
+		}
+
+		spin_mutex::scoped_lock l(lock);
+		vector<RouteCacheEntry> &p = entries[make_pair(e.key.from, e.key.to)];
+		if (p.size() >= CACHE_ENTRIES_PER_PAIR) continue;
+
+		bool covered = false;
+		for (unsigned int j = 0; j < p.size() && !covered; j++)
+		{
+			covered = covers(p[j].key, e.key);
+		}
+		if (covered) continue;
+
+		e.last_used = n - i;
+		clock = max(clock, e.last_used);
+		p.push_back(std::move(e));
+	}
+
+	return true;
+}
+
+/**
+ * The entries are written from the most to the least recently used one, until
+ * the file would exceed CACHE_FILE_SIZE bytes. The remaining entries are dropped.
+ */
+bool oma::RouteCache::save(const string &filename)
+{
+	ofstream out(filename.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!out.is_open()) return false;
+
+	spin_mutex::scoped_lock l(lock);
+
+	out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	write_value(out, CACHE_FORMAT);
+	write_value(out, version);
+
+	vector<const RouteCacheEntry*> all;
+	map<pair<string, string>, vector<RouteCacheEntry> >::const_iterator i;
+	for (i = entries.begin(); i != entries.end(); ++i)
+	{
+		for (unsigned int j = 0; j < i->second.size(); j++)
+		{
+			all.push_back(&(i->second[j]));
+		}
+	}
+	sort(all.begin(), all.end(), more_recently_used);
+
+	unsigned int n = 0;
+	unsigned long bytes = sizeof(CACHE_MAGIC) + sizeof(CACHE_FORMAT) + sizeof(version)
+			+ sizeof(n);
+	while (n < all.size() && (bytes += entry_bytes(*all[n])) <= CACHE_FILE_SIZE)
+	{
+		n++;
+	}
+	write_value(out, n);
+
+	for (unsigned int j = 0; j < n; j++)
+	{
+		const RouteCacheEntry *e = all[j];
+		write_string(out, e->key.from);
+		write_string(out, e->key.to);
+		write_value(out, e->key.t_min);
+		write_value(out, e->key.t_max);
+		write_value(out, e->key.max_layover_time);
+		write_value(out, e->key.max_hops);
+		write_value(out, e->key.bidirectional_depth);
+		write_value(out, (unsigned int) e->travels.size());
+
+		for (unsigned int k = 0; k < e->travels.size(); k++)
+		{
+			write_travel(out, e->travels[k]);
+		}
+	}
+
+	return out.good();
+}
+
+unsigned int oma::RouteCache::size()
+{
+	spin_mutex::scoped_lock l(lock);
+
+	unsigned int n = 0;
+	map<pair<string, string>, vector<RouteCacheEntry> >::const_iterator i;
+	for (i = entries.begin(); i != entries.end(); ++i)
+	{
+		n += i->second.size();
+	}
+	return n;
+}
@@ -0,0 +1,135 @@
+/*!
+ * @file route_cache.h
+ * @brief This file contains declarations for the partial route cache.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef ROUTECACHE_H_
+#define ROUTECACHE_H_
+
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+#include "tbb/spin_mutex.h"
+
+#include "../types.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// Identifies the result of a partial route search.
+/** The result of a route search only depends on its end points, the time
+ *  window, the maximum layover time and the search limits (the flight data
+ *  is identified by the cache itself). */
+struct RouteCacheKey
+{
+	string from;/*!< The origin. */
+	string to;/*!< The destination. */
+	unsigned long t_min;/*!< You must not be in a plane before this value (epoch). */
+	unsigned long t_max;/*!< You must not be in a plane after this value (epoch). */
+	unsigned long max_layover_time;/*!< Maximum layover time between two flights. */
+	unsigned int max_hops;/*!< Maximum number of flights per route (0 = unlimited). */
+	unsigned int bidirectional_depth;/*!< Depth of a bidirectional search (0 = forward search). */
+};
+
+/// A cached result of a partial route search.
+struct RouteCacheEntry
+{
+	RouteCacheKey key;/*!< The search that produced the routes. */
+	Travels travels;/*!< The filtered routes. */
+	unsigned long last_used;/*!< When the entry was stored or used last (see "RouteCache::clock"). */
+};
+
+/// Caches the results of partial route searches.
+/** Each "FindPathTask" result (i.e. the filtered list of possible routes
+ *  between two locations) is stored together with the parameters of its search.
+ *  A later search with the same parameters is answered from the cache.
+ *
+ *  A search whose time window lies WITHIN the window of a cached search is
+ *  answered by filtering the cached routes, too. This is only correct if the
+ *  cheapest of the cached routes lies within the smaller window: in this case,
+ *  the cheapest route (and thus the cost bound) of both searches is the same.
+ *
+ *  Cached results are only valid for the flight data they were computed from.
+ *  Therefore, the cache stores a version number of the flight data and ignores
+ *  all entries of other versions when loading them from disk.
+ *
+ *  The cache is bounded: A new entry replaces all entries of the same search
+ *  limits whose time window lies within its own window. Each pair of locations
+ *  keeps at most CACHE_ENTRIES_PER_PAIR entries, and the least recently used
+ *  entry is evicted first. The cache file holds the most recently used entries
+ *  up to CACHE_FILE_SIZE bytes. */
+class RouteCache
+{
+private:
+	/// Cached entries, grouped by origin and destination.
+	map<pair<string, string>, vector<RouteCacheEntry> > entries;
+
+	/// Protects the entries against concurrent access.
+	tbb::spin_mutex lock;
+
+	/// Version of the flight data.
+	unsigned long version;
+
+	/// Logical time, which is advanced whenever an entry is stored or used.
+	unsigned long clock;
+
+	/// Answers a search from a cached entry.
+	/** @param e   The cached entry.
+	 *  @param k   The search.
+	 *  @param out Output vector.
+	 *  @return    TRUE if the search could be answered. */
+	bool answer(const RouteCacheEntry &e, const RouteCacheKey &k, Travels *out) const;
+
+public:
+	/// Creates an empty cache.
+	/** @param v Version of the flight data. */
+	RouteCache(unsigned long v);
+
+	/// Looks up the result of a search.
+	/** @param k   The search.
+	 *  @param out Output vector. Routes are only appended if the search could be
+	 *             answered.
+	 *  @return    TRUE if the search could be answered from the cache. */
+	bool find(const RouteCacheKey &k, Travels *out);
+
+	/// Stores the result of a search.
+	/** @param k The search.
+	 *  @param t The filtered routes. */
+	void insert(const RouteCacheKey &k, const Travels &t);
+
+	/// Loads cached entries from a file.
+	/** Entries of other flight data versions are ignored.
+	 *  @param filename The file name.
+	 *  @return         TRUE if the file could be read. */
+	bool load(const string &filename);
+
+	/// Saves all cached entries to a file.
+	/** @param filename The file name.
+	 *  @return         TRUE if the file could be written. */
+	bool save(const string &filename);
+
+	/// Gets the number of cached entries.
+	unsigned int size();
+};
+
+/// Writes a travel in binary form.
+/** Flights are written as their indices in the flight table.
+ *  @param out The output stream.
+ *  @param t   The travel. */
+void write_travel(ostream &out, const Travel &t);
+
+/// Reads a travel in binary form.
+/** @param in The input stream.
+ *  @param t  Output travel.
+ *  @return   TRUE if the travel could be read (FALSE if the stream ended or the
+ *            travel is invalid, e.g. due to a corrupt file). */
+bool read_travel(istream &in, Travel *t);
+
+}
+
+#endif /* ROUTECACHE_H_ */
@@ -0,0 +1,300 @@
+/*!
+ * @file route_store.cpp
+ * @brief This file contains the implementation of the bounded-memory route store.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+#include "tbb/concurrent_vector.h"
+
+#include "route_store.h"
+#include "route_cache.h"
+
+using namespace std;
+using namespace oma;
+
+/// Memory budget of all route stores (in bytes, 0 = unlimited).
+static unsigned long memory_budget = 0;
+
+/// A route store is only spilled if it holds at least 1/SPILL_SHARE of the budget.
+/** Otherwise, once the budget is exceeded due to OTHER stores, every insertion
+ *  into a small store would write its one or two routes to disk. */
+#define SPILL_SHARE 16
+
+/// Estimated memory usage of all route stores (in bytes).
+static atomic<unsigned long> memory_in_use(0);
+
+/// Names of all temporary files (removed by "remove_spill_files" on fatal errors).
+static tbb::concurrent_vector<string> spill_files;
+
+/// Removes the temporary files of all route stores.
+/** Route stores remove their own files when they are destroyed, but a fatal
+ *  error exits the program without destroying them. */
+static void remove_spill_files()
+{
+	for (unsigned int i = 0; i < spill_files.size(); i++)
+	{
+		unlink(spill_files[i].c_str());
+	}
+}
+
+/// Estimates the memory usage of a route.
+static unsigned long travel_bytes(const Travel &t)
+{
+	return sizeof(Travel) + t.flights.heap_bytes() + t.discounts.heap_bytes();
+}
+
+oma::RouteStore::RouteStore()
+{
+	bytes = 0;
+	spilled = 0;
+	spill_end = 0;
+	spill_failed = false;
+	read = 0;
+	bound = numeric_limits<Cost>::max();
+	evicted_bound = bound;
+	evicted_size = 0;
+}
+
+oma::RouteStore::~RouteStore()
+{
+	memory_in_use -= bytes;
+
+	if (spill_file != "")
+	{
+		spill.close();
+		unlink(spill_file.c_str());
+	}
+}
+
+void oma::RouteStore::set_memory_budget(unsigned long b)
+{
+	memory_budget = b;
+}
+
+/**
+ * The route is only copied if it is not ignored.
+ */
+void oma::RouteStore::push_back(const Travel &t)
+{
+	if (t.min_cost > bound)
+	{
+		return;
+	}
+
+	push_back(Travel(t));
+}
+
+/**
+ * If the routes of all route stores exceed the memory budget, the routes of
+ * THIS route store are spilled to disk (since the other stores may be in use by
+ * other threads), but only if they make up a considerable share of the budget.
+ * Thus, the memory usage can exceed the budget by 1/SPILL_SHARE of the budget
+ * per route store.
+ */
+void oma::RouteStore::push_back(Travel &&t)
+{
+	if (t.min_cost > bound)
+	{
+		return;
+	}
+
+	unsigned long b = travel_bytes(t);
+
+	routes.push_back(std::move(t));
+	bytes += b;
+
+	if ((memory_in_use += b) > memory_budget && memory_budget > 0
+			&& bytes >= memory_budget / SPILL_SHARE && !spill_failed)
+	{
+		spill_routes();
+	}
+}
+
+/**
+ * An eviction pass is only started when the bound tightened since the last
+ * pass AND the number of routes in memory has (roughly) doubled. This keeps
+ * the amortized costs of evicting constant per route.
+ */
+void oma::RouteStore::set_bound(Cost max)
+{
+	bound = max;
+
+	if (bound < evicted_bound && routes.size() >= 2 * evicted_size + 16)
+	{
+		evict();
+	}
+}
+
+/// Tests if a route is more expensive than a bound.
+class MoreExpensiveThan
+{
+private:
+	Cost max;
+
+public:
+	MoreExpensiveThan(Cost m) :
+			max(m)
+	{
+	}
+
+	bool operator()(const Travel &t) const
+	{
+		return t.min_cost > max;
+	}
+};
+
+void oma::RouteStore::evict()
+{
+	Travels::iterator end = remove_if(routes.begin(), routes.end(),
+			MoreExpensiveThan(bound));
+
+	for (Travels::iterator i = end; i != routes.end(); ++i)
+	{
+		unsigned long b = travel_bytes(*i);
+		bytes -= b;
+		memory_in_use -= b;
+	}
+
+	routes.erase(end, routes.end());
+
+	evicted_bound = bound;
+	evicted_size = routes.size();
+}
+
+/**
+ * The routes in memory are moved into the output vector (no copy, if it is
+ * empty). Spilled routes are read back one by one and filtered.
+ */
+void oma::RouteStore::take(Travels *out)
+{
+	evict();
+
+	memory_in_use -= bytes;
+	bytes = 0;
+
+	if (out->empty())
+	{
+		out->swap(routes);
+	}
+	else
+	{
+		out->insert(out->end(), make_move_iterator(routes.begin()),
+				make_move_iterator(routes.end()));
+	}
+	Travels().swap(routes);
+
+	Travel t;
+	rewind();
+	while (next(&t))
+	{
+		if (t.min_cost <= bound)
+		{
+			out->push_back(std::move(t));
+		}
+	}
+}
+
+/**
+ * The temporary file is created on the first spill (in $TMPDIR, or /tmp). The
+ * routes are appended to it.
+ */
+void oma::RouteStore::spill_routes()
+{
+	if (spill_file == "")
+	{
+		const char *dir = getenv("TMPDIR");
+		string name = string(dir != NULL ? dir : "/tmp") + "/oma_routes_XXXXXX";
+
+		int fd = mkstemp(&(name[0]));
+		if (fd < 0)
+		{
+			cerr << "Could not create temporary file " << name
+					<< ", routes are kept in memory" << endl;
+			spill_failed = true;
+			return;
+		}
+		close(fd);
+
+		spill_file = name;
+		spill_files.push_back(name);
+		spill.open(spill_file.c_str(), ios::in | ios::out | ios::binary | ios::trunc);
+	}
+
+	spill.clear();
+	spill.seekp(spill_end);
+
+	for (unsigned int i = 0; i < routes.size() && spill.good(); i++)
+	{
+		write_travel(spill, routes[i]);
+	}
+	spill.flush();
+
+	if (!spill.good())
+	{
+		cerr << "Could not write temporary file " << spill_file
+				<< ", routes are kept in memory" << endl;
+		spill_failed = true;
+
+		// Reopening discards the data that could not be written, so that the routes
+		// that were spilled before can still be read.
+		spill.close();
+		spill.clear();
+		spill.open(spill_file.c_str(), ios::in | ios::out | ios::binary);
+		return;
+	}
+
+	spill_end = spill.tellp();
+	spilled += routes.size();
+	memory_in_use -= bytes;
+	bytes = 0;
+
+	Travels().swap(routes);
+}
+
+unsigned long oma::RouteStore::size() const
+{
+	return routes.size() + spilled;
+}
+
+void oma::RouteStore::rewind()
+{
+	read = 0;
+
+	if (spill_file != "")
+	{
+		spill.flush();
+		spill.clear();
+		spill.seekg(0, ios::beg);
+	}
+}
+
+bool oma::RouteStore::next(Travel *t)
+{
+	if (read >= spilled)
+	{
+		return false;
+	}
+
+	*t = Travel();
+	read++;
+
+	// Skipping the remaining routes could silently change the cheapest solution,
+	// so a spill file that cannot be read back is fatal.
+	if (!read_travel(spill, t))
+	{
+		cerr << "Could not read temporary file " << spill_file << endl;
+		remove_spill_files();
+		exit(130);
+	}
+	return true;
+}
@@ -0,0 +1,136 @@
+/*!
+ * @file route_store.h
+ * @brief This file contains declarations for the bounded-memory route store.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef ROUTESTORE_H_
+#define ROUTESTORE_H_
+
+#include <string>
+#include <fstream>
+
+#include "../types.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// Stores the routes found by a route search.
+/** With a large maximum layover time, a route search can find a huge number
+ *  of routes before they are filtered. In order to keep the memory usage
+ *  bounded, a route store moves its routes into a temporary file (in compact
+ *  binary form) as soon as the routes of ALL route stores exceed the memory
+ *  budget (see "set_memory_budget") and the store holds a considerable share
+ *  of the budget itself. The routes on disk can be read back one by one, so
+ *  that they never need to be in memory at the same time.
+ *
+ *  Routes are filtered while they are added: a route store knows the maximum
+ *  price of the cheapest route found so far (see "set_bound"). Routes whose
+ *  minimum price exceeds this bound are not stored at all, and stored routes are
+ *  evicted as soon as the bound tightens. Evicting costs a pass over all stored
+ *  routes, so it only happens when the store has grown considerably since the
+ *  last pass. This way, the memory usage stays proportional to the number of
+ *  useful routes.
+ *
+ *  A route store is not synchronized; concurrent calls of "push_back" and
+ *  "set_bound" need to be protected by the caller. */
+class RouteStore
+{
+private:
+	/// Routes in memory.
+	Travels routes;
+
+	/// Estimated memory usage of the routes in memory (in bytes).
+	unsigned long bytes;
+
+	/// Temporary file with the spilled routes.
+	fstream spill;
+
+	/// Name of the temporary file (empty if no routes were spilled yet).
+	string spill_file;
+
+	/// Number of spilled routes.
+	unsigned long spilled;
+
+	/// End of the spilled routes in the temporary file.
+	/** Routes are always written here, so that a failed write cannot leave
+	 *  garbage between valid routes. */
+	streampos spill_end;
+
+	/// TRUE if spilling failed (e.g. disk full). The routes stay in memory then.
+	bool spill_failed;
+
+	/// Number of spilled routes that have been read since the last "rewind".
+	unsigned long read;
+
+	/// Maximum price of the cheapest known route.
+	Cost bound;
+
+	/// Bound at the last eviction pass.
+	Cost evicted_bound;
+
+	/// Number of routes in memory after the last eviction pass.
+	unsigned long evicted_size;
+
+	/// Moves all routes in memory into the temporary file.
+	/** If the routes cannot be written, they stay in memory and spilling is
+	 *  disabled for this store. */
+	void spill_routes();
+
+	/// Removes all routes from memory that are more expensive than the bound.
+	void evict();
+
+	// Not copyable (the temporary file is not, either).
+	RouteStore(const RouteStore &s);
+	RouteStore &operator=(const RouteStore &s);
+
+public:
+	/// Creates an empty route store.
+	RouteStore();
+
+	/// Destroys the route store and deletes its temporary file.
+	~RouteStore();
+
+	/// Sets the memory budget of ALL route stores.
+	/** @param b The memory budget in bytes (0 = unlimited). */
+	static void set_memory_budget(unsigned long b);
+
+	/// Adds a route.
+	/** The route is ignored if it is more expensive than the bound.
+	 *  @param t The route. */
+	void push_back(const Travel &t);
+
+	/// Moves a route into the store.
+	/** The route is ignored if it is more expensive than the bound.
+	 *  @param t The route. It is empty afterwards, unless it was ignored. */
+	void push_back(Travel &&t);
+
+	/// Sets the maximum price of the cheapest known route.
+	/** @param max The maximum price. */
+	void set_bound(Cost max);
+
+	/// Moves all routes that are not more expensive than the bound into a vector.
+	/** Afterwards, the route store is empty.
+	 *  @param out Output vector. */
+	void take(Travels *out);
+
+	/// Gets the total number of routes (in memory and on disk).
+	unsigned long size() const;
+
+	/// Starts reading the spilled routes from the beginning.
+	void rewind();
+
+	/// Reads the next spilled route.
+	/** The program exits with an error if the route cannot be read back.
+	 *
+	 *  @param t Output route.
+	 *  @return  FALSE if there are no more spilled routes. */
+	bool next(Travel *t);
+};
+
+}
+
+#endif /* ROUTESTORE_H_ */
@@ -0,0 +1,148 @@
+/*!
+ * @file search_profile.cpp
+ * @brief This file contains the implementation of route search profiles.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <fstream>
+
+#include "search_profile.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// Names of the predicates in the JSON output.
+static const char *predicate_names[PREDICATE_COUNT] =
+{ "max_hops", "time_window", "cost_estimate", "connection", "visited", "cost_exact" };
+
+/// All profiles, in the order in which they were created.
+static vector<SearchProfile*> profiles;
+
+/// Protects the profile list.
+static spin_mutex profiles_lock;
+
+oma::SearchLevel::SearchLevel() :
+		routes(0), edges(0), accepted(0)
+{
+	for (unsigned int i = 0; i < PREDICATE_COUNT; i++)
+	{
+		failed[i] = 0;
+	}
+}
+
+oma::SearchProfile::SearchProfile(const string &n, bool fw) :
+		start(tick_count::now()), end(start), name(n), forward(fw)
+{
+}
+
+SearchLevel &oma::SearchProfile::level(unsigned int l)
+{
+	deque<SearchLevel> &d = levels.local();
+	while (d.size() <= l)
+	{
+		d.push_back(SearchLevel());
+	}
+	return d[l];
+}
+
+/**
+ * Only finite bounds are recorded (the bound is infinite until the first route
+ * to a destination has been found).
+ */
+void oma::SearchProfile::bound_changed(Cost c)
+{
+	if (c == numeric_limits<Cost>::max())
+	{
+		return;
+	}
+
+	spin_mutex::scoped_lock l(bounds_lock);
+	bounds.push_back(make_pair((tick_count::now() - start).seconds(), c));
+}
+
+void oma::SearchProfile::finish()
+{
+	end = tick_count::now();
+}
+
+void oma::SearchProfile::write_json(ostream &out)
+{
+	deque<SearchLevel> total;
+	enumerable_thread_specific<deque<SearchLevel> >::iterator d;
+	for (d = levels.begin(); d != levels.end(); ++d)
+	{
+		for (unsigned int l = 0; l < d->size(); l++)
+		{
+			if (total.size() <= l) total.push_back(SearchLevel());
+
+			SearchLevel &s = (*d)[l];
+			total[l].routes += s.routes;
+			total[l].edges += s.edges;
+			total[l].accepted += s.accepted;
+			for (unsigned int p = 0; p < PREDICATE_COUNT; p++)
+			{
+				total[l].failed[p] += s.failed[p];
+			}
+		}
+	}
+
+	out << "    {" << endl;
+	out << "      \"name\": \"" << name << "\"," << endl;
+	out << "      \"direction\": \"" << (forward ? "forward" : "backward") << "\"," << endl;
+	out << "      \"seconds\": " << (end - start).seconds() << "," << endl;
+	out << "      \"levels\": [";
+	for (unsigned int l = 0; l < total.size(); l++)
+	{
+		SearchLevel &s = total[l];
+		out << (l > 0 ? "," : "") << endl << "        { \"level\": " << l << ", \"routes\": "
+				<< s.routes << ", \"edges\": " << s.edges << ", \"accepted\": " << s.accepted
+				<< ", \"branching_factor\": " << (s.routes > 0 ? (double) s.accepted / s.routes : 0)
+				<< ", \"failed\": { ";
+		for (unsigned int p = 0; p < PREDICATE_COUNT; p++)
+		{
+			out << (p > 0 ? ", " : "") << "\"" << predicate_names[p] << "\": " << s.failed[p];
+		}
+		out << " } }";
+	}
+	out << endl << "      ]," << endl;
+
+	spin_mutex::scoped_lock lock(bounds_lock);
+	out << "      \"bound\": [";
+	for (unsigned int i = 0; i < bounds.size(); i++)
+	{
+		out << (i > 0 ? ", " : "") << "[" << bounds[i].first << ", "
+				<< (double) bounds[i].second / COST_UNITS << "]";
+	}
+	out << "]" << endl << "    }";
+}
+
+SearchProfile *oma::new_search_profile(const string &name, bool forward)
+{
+	SearchProfile *p = new SearchProfile(name, forward);
+
+	spin_mutex::scoped_lock l(profiles_lock);
+	profiles.push_back(p);
+	return p;
+}
+
+bool oma::write_search_profiles(const string &filename)
+{
+	ofstream out(filename.c_str());
+	if (!out.is_open()) return false;
+
+	spin_mutex::scoped_lock l(profiles_lock);
+
+	out << "{" << endl << "  \"searches\": [";
+	for (unsigned int i = 0; i < profiles.size(); i++)
+	{
+		out << (i > 0 ? "," : "") << endl;
+		profiles[i]->write_json(out);
+		delete profiles[i];
+	}
+	out << endl << "  ]" << endl << "}" << endl;
+	profiles.clear();
+
+	return out.good();
+}
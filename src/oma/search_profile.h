@@ -0,0 +1,117 @@
+/*!
+ * @file search_profile.h
+ * @brief This file contains declarations for profiling route searches.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef SEARCH_PROFILE_H_
+#define SEARCH_PROFILE_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <ostream>
+#include "tbb/tick_count.h"
+#include "tbb/spin_mutex.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "../types.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// Reasons why a flight cannot extend a route.
+enum SearchPredicate
+{
+	PREDICATE_MAX_HOPS,/*!< The route already has the maximum number of flights. */
+	PREDICATE_TIME_WINDOW,/*!< The flight lies outside of the time window. */
+	PREDICATE_COST_ESTIMATE,/*!< The estimated costs exceed the bound. */
+	PREDICATE_CONNECTION,/*!< The flight does not connect (too early or layover too long). */
+	PREDICATE_VISITED,/*!< The flight leads to a city that the route already visited. */
+	PREDICATE_COST_EXACT,/*!< The exact minimal costs of the extended route exceed the bound. */
+	PREDICATE_COUNT
+};
+
+/// Statistics of one level of a route search.
+/** Level n contains the routes with n flights. Extending them (i.e. testing
+ *  their follow-up flights) creates the routes of level n + 1. */
+struct SearchLevel
+{
+	unsigned long routes;/*!< Routes that were extended. */
+	unsigned long edges;/*!< Follow-up flights that were tested. */
+	unsigned long accepted;/*!< Follow-up flights that extended a route. */
+	unsigned long failed[PREDICATE_COUNT];/*!< Follow-up flights rejected by each predicate. */
+
+	/// Creates empty statistics.
+	SearchLevel();
+};
+
+/// Profile of a single route search.
+/** A profile records the explored routes per level, the number of rejected
+ *  follow-up flights per predicate and the cost bound of the search over time.
+ *  Each thread records into its own level statistics, so that recording does
+ *  not need any locks. */
+class SearchProfile
+{
+private:
+	/// Level statistics of each thread (a deque keeps references valid while growing).
+	tbb::enumerable_thread_specific<deque<SearchLevel> > levels;
+
+	/// Changes of the cost bound (seconds since the start, new bound).
+	vector<pair<double, Cost> > bounds;
+
+	/// Protects the bound list.
+	tbb::spin_mutex bounds_lock;
+
+	tbb::tick_count start, end;
+
+public:
+	/// Name of the search (e.g. "CHICAGO -> SEATTLE").
+	string name;
+
+	/// TRUE for a forward search, FALSE for a backward search.
+	bool forward;
+
+	/// Starts a new profile.
+	/** @param n  Name of the search.
+	 *  @param fw TRUE for a forward search, FALSE for a backward search. */
+	SearchProfile(const string &n, bool fw);
+
+	/// Gets the calling thread's statistics of a level.
+	/** @param l The level (i.e. the number of flights of the extended routes). */
+	SearchLevel &level(unsigned int l);
+
+	/// Records a new cost bound.
+	/** @param c The new bound. */
+	void bound_changed(Cost c);
+
+	/// Ends the profile.
+	void finish();
+
+	/// Writes the profile as JSON object.
+	/** The level statistics of all threads are summed up.
+	 *
+	 *  @param out Output stream. */
+	void write_json(ostream &out);
+};
+
+/// Creates a new search profile.
+/** The profile is kept until the profiles are written (see "write_search_profiles").
+ *
+ *  @param name    Name of the search.
+ *  @param forward TRUE for a forward search, FALSE for a backward search.
+ *  @return        The new profile. */
+SearchProfile *new_search_profile(const string &name, bool forward);
+
+/// Writes all search profiles as JSON and deletes them.
+/** @param filename The output file name.
+ *  @return         TRUE if the file could be written. */
+bool write_search_profiles(const string &filename);
+
+}
+
+#endif /* SEARCH_PROFILE_H_ */
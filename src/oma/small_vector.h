@@ -0,0 +1,234 @@
+/*!
+ * @file small_vector.h
+ * @brief This file contains a vector with inline storage for few elements.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef SMALLVECTOR_H_
+#define SMALLVECTOR_H_
+
+#include <cstring>
+#include <cassert>
+#include <climits>
+
+namespace oma
+{
+
+/// A vector that stores up to N elements without allocating memory.
+/** Most routes consist of only a few flights. Storing their flights in a
+ *  "std::vector" means one heap allocation per route (and per copy of a route).
+ *  This vector stores up to N elements inline; only longer vectors fall back to
+ *  heap memory. Copying a short vector is therefore just a copy of the object.
+ *
+ *  The element type must be a plain value type (it is copied with memcpy). */
+template<typename T, unsigned int N>
+class SmallVector
+{
+private:
+	/// The elements (inline as long as "capacity" is N).
+	union
+	{
+		T local[N];
+		T *heap;
+	};
+
+	/// Number of elements.
+	unsigned short count;
+
+	/// Number of elements that fit without reallocating.
+	unsigned short capacity;
+
+	/// Gets the first element.
+	T *data()
+	{
+		return capacity > N ? heap : local;
+	}
+
+	/// Gets the first element.
+	const T *data() const
+	{
+		return capacity > N ? heap : local;
+	}
+
+	/// Grows the vector (keeping its elements) to fit at least c elements.
+	/** @param c The new capacity. Must not exceed "max_size()", since the size is
+	 *           stored in a short counter. */
+	void reserve(unsigned int c)
+	{
+		if (c <= capacity)
+		{
+			return;
+		}
+
+		assert(c <= max_size());
+
+		unsigned int n = capacity * 2;
+		if (n < c) n = c;
+		if (n > max_size()) n = max_size();
+
+		T *h = new T[n];
+		memcpy(h, data(), count * sizeof(T));
+
+		if (capacity > N)
+		{
+			delete[] heap;
+		}
+
+		heap = h;
+		capacity = n;
+	}
+
+public:
+	/// Creates an empty vector.
+	SmallVector() :
+			count(0), capacity(N)
+	{
+	}
+
+	/// Copies a vector.
+	SmallVector(const SmallVector &v) :
+			count(0), capacity(N)
+	{
+		*this = v;
+	}
+
+	/// Moves a vector. Heap memory is taken over; v is empty afterwards.
+	SmallVector(SmallVector &&v) :
+			count(0), capacity(N)
+	{
+		*this = static_cast<SmallVector&&>(v);
+	}
+
+	/// Destroys the vector.
+	~SmallVector()
+	{
+		if (capacity > N)
+		{
+			delete[] heap;
+		}
+	}
+
+	/// Copies a vector. The own heap memory is reused if it is large enough.
+	SmallVector &operator=(const SmallVector &v)
+	{
+		if (this != &v)
+		{
+			reserve(v.count);
+			memcpy(data(), v.data(), v.count * sizeof(T));
+			count = v.count;
+		}
+		return *this;
+	}
+
+	/// Moves a vector. Heap memory is taken over; v is empty afterwards.
+	SmallVector &operator=(SmallVector &&v)
+	{
+		if (this == &v)
+		{
+			return *this;
+		}
+
+		if (v.capacity > N)
+		{
+			if (capacity > N)
+			{
+				delete[] heap;
+			}
+
+			heap = v.heap;
+			capacity = v.capacity;
+			count = v.count;
+
+			v.capacity = N;
+			v.count = 0;
+		}
+		else
+		{
+			*this = static_cast<const SmallVector&>(v);
+			v.count = 0;
+		}
+
+		return *this;
+	}
+
+	/// Gets the maximum number of elements.
+	static unsigned int max_size()
+	{
+		return USHRT_MAX;
+	}
+
+	/// Gets the number of elements.
+	unsigned int size() const
+	{
+		return count;
+	}
+
+	/// Tests if the vector is empty.
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	/// Gets an element.
+	T &operator[](unsigned int i)
+	{
+		return data()[i];
+	}
+
+	/// Gets an element.
+	const T &operator[](unsigned int i) const
+	{
+		return data()[i];
+	}
+
+	/// Gets the first element.
+	const T &front() const
+	{
+		return data()[0];
+	}
+
+	/// Gets the last element.
+	const T &back() const
+	{
+		return data()[count - 1];
+	}
+
+	/// Appends an element.
+	void push_back(const T &e)
+	{
+		reserve(count + 1);
+		data()[count++] = e;
+	}
+
+	/// Appends all elements of another vector.
+	void append(const SmallVector &v)
+	{
+		reserve(count + v.count);
+		memcpy(data() + count, v.data(), v.count * sizeof(T));
+		count += v.count;
+	}
+
+	/// Resizes the vector. New elements are not initialized.
+	void resize(unsigned int s)
+	{
+		reserve(s);
+		count = s;
+	}
+
+	/// Removes all elements (but keeps the heap memory, if any).
+	void clear()
+	{
+		count = 0;
+	}
+
+	/// Gets the size of the heap memory used by this vector (in bytes).
+	unsigned long heap_bytes() const
+	{
+		return capacity > N ? capacity * sizeof(T) : 0;
+	}
+};
+
+}
+
+#endif /* SMALLVECTOR_H_ */
@@ -0,0 +1,201 @@
+/*!
+ * @file stats.cpp
+ * @brief This file contains the implementation of phase timings and search counters.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <fstream>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include "tbb/spin_mutex.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "stats.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// A recorded phase.
+struct Phase
+{
+	string name;
+	string label;
+	double seconds;
+	bool has_counters;
+	PerfValues counters;
+};
+
+/// Counters of all threads.
+static enumerable_thread_specific<StatsCounters> counters;
+
+/// All recorded phases, in the order in which they ended.
+static vector<Phase> phases;
+
+/// Protects the phase list.
+static spin_mutex phases_lock;
+
+StatsCounters &oma::stats_counters()
+{
+	return counters.local();
+}
+
+void oma::record_phase(const string &name, const string &label, double seconds,
+		const PerfValues *counters)
+{
+	Phase p;
+	p.name = name;
+	p.label = label;
+	p.seconds = seconds;
+	p.has_counters = counters != NULL;
+	if (counters != NULL) p.counters = *counters;
+
+	spin_mutex::scoped_lock l(phases_lock);
+	phases.push_back(p);
+}
+
+/// Writes a string as JSON string literal.
+static void write_json_string(ostream &out, const string &s)
+{
+	out << '"';
+	for (unsigned int i = 0; i < s.size(); i++)
+	{
+		if (s[i] == '"' || s[i] == '\\') out << '\\';
+		out << s[i];
+	}
+	out << '"';
+}
+
+/// Writes hardware event counts (and the instructions per cycle) as members of a JSON object.
+static void write_json_counters(ostream &out, const PerfValues &v)
+{
+	for (unsigned int e = 0; e < PERF_EVENTS; e++)
+	{
+		out << (e > 0 ? ", \"" : "\"") << perf_event_name(e) << "\": " << v.values[e];
+	}
+	out << ", \"ipc\": "
+			<< (v.values[PERF_CYCLES] > 0 ?
+					(double) v.values[PERF_INSTRUCTIONS] / v.values[PERF_CYCLES] : 0);
+}
+
+/// Sums up the hardware events of all instances of each phase name.
+static map<string, PerfValues> phase_counter_totals()
+{
+	map<string, PerfValues> totals;
+	for (unsigned int i = 0; i < phases.size(); i++)
+	{
+		if (phases[i].has_counters) totals[phases[i].name] += phases[i].counters;
+	}
+	return totals;
+}
+
+/**
+ * Besides the list of all phases, the file contains the total time of each
+ * phase name (summed over all instances). Note that phases can overlap, since
+ * route searches and merges run concurrently.
+ */
+bool oma::write_stats(const string &filename)
+{
+	ofstream out(filename.c_str());
+	if (!out.is_open()) return false;
+
+	StatsCounters total;
+	enumerable_thread_specific<StatsCounters>::const_iterator c;
+	for (c = counters.begin(); c != counters.end(); ++c)
+	{
+		total.routes_expanded += c->routes_expanded;
+		total.routes_pruned += c->routes_pruned;
+		total.routes_emitted += c->routes_emitted;
+		total.merge_pairs += c->merge_pairs;
+	}
+
+	spin_mutex::scoped_lock l(phases_lock);
+
+	map<string, double> totals;
+	out << "{" << endl << "  \"phases\": [";
+	for (unsigned int i = 0; i < phases.size(); i++)
+	{
+		totals[phases[i].name] += phases[i].seconds;
+
+		out << (i > 0 ? "," : "") << endl << "    { \"name\": ";
+		write_json_string(out, phases[i].name);
+		out << ", \"label\": ";
+		write_json_string(out, phases[i].label);
+		out << ", \"seconds\": " << phases[i].seconds;
+		if (phases[i].has_counters)
+		{
+			out << ", ";
+			write_json_counters(out, phases[i].counters);
+		}
+		out << " }";
+	}
+	out << endl << "  ]," << endl << "  \"phase_totals\": {";
+
+	map<string, double>::const_iterator t;
+	for (t = totals.begin(); t != totals.end(); ++t)
+	{
+		out << (t != totals.begin() ? "," : "") << endl << "    ";
+		write_json_string(out, t->first);
+		out << ": " << t->second;
+	}
+
+	if (perf_counters_enabled())
+	{
+		map<string, PerfValues> counter_totals = phase_counter_totals();
+		map<string, PerfValues>::const_iterator c;
+		out << endl << "  }," << endl << "  \"phase_perf_counters\": {";
+		for (c = counter_totals.begin(); c != counter_totals.end(); ++c)
+		{
+			out << (c != counter_totals.begin() ? "," : "") << endl << "    ";
+			write_json_string(out, c->first);
+			out << ": { ";
+			write_json_counters(out, c->second);
+			out << " }";
+		}
+
+		vector<PerfValues> threads = read_thread_perf_counters();
+		out << endl << "  }," << endl << "  \"thread_perf_counters\": [";
+		for (unsigned int i = 0; i < threads.size(); i++)
+		{
+			out << (i > 0 ? "," : "") << endl << "    { \"thread\": " << i << ", ";
+			write_json_counters(out, threads[i]);
+			out << " }";
+		}
+		out << endl << "  ]," << endl << "  \"counters\": {" << endl;
+	}
+	else
+	{
+		out << endl << "  }," << endl << "  \"counters\": {" << endl;
+	}
+	out << "    \"routes_expanded\": " << total.routes_expanded << "," << endl;
+	out << "    \"routes_pruned\": " << total.routes_pruned << "," << endl;
+	out << "    \"routes_emitted\": " << total.routes_emitted << "," << endl;
+	out << "    \"merge_pairs\": " << total.merge_pairs << endl;
+	out << "  }" << endl << "}" << endl;
+
+	return out.good();
+}
+
+void oma::print_phase_counters(ostream &out)
+{
+	spin_mutex::scoped_lock l(phases_lock);
+
+	map<string, PerfValues> totals = phase_counter_totals();
+	map<string, PerfValues>::const_iterator t;
+	char line[256];
+
+	snprintf(line, sizeof(line), "%-16s %16s %16s %6s %14s %14s", "Phase", "Cycles",
+			"Instructions", "IPC", "Cache misses", "Branch misses");
+	out << line << endl;
+	for (t = totals.begin(); t != totals.end(); ++t)
+	{
+		const unsigned long long *v = t->second.values;
+		snprintf(line, sizeof(line), "%-16s %16llu %16llu %6.2f %14llu %14llu",
+				t->first.c_str(), v[PERF_CYCLES], v[PERF_INSTRUCTIONS],
+				v[PERF_CYCLES] > 0 ? (double) v[PERF_INSTRUCTIONS] / v[PERF_CYCLES] : 0,
+				v[PERF_CACHE_MISSES], v[PERF_BRANCH_MISSES]);
+		out << line << endl;
+	}
+}
@@ -0,0 +1,115 @@
+/*!
+ * @file stats.h
+ * @brief This file contains declarations for phase timings and search counters.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <string>
+#include <ostream>
+#include "tbb/tick_count.h"
+
+#include "perf_counters.h"
+
+using namespace std;
+
+namespace oma
+{
+
+/// Counters of the route search and the route merging.
+/** Each thread has its own set of counters (see "stats_counters"), so counting
+ *  needs neither locks nor atomic operations. The counters of all threads are
+ *  summed up when the statistics are written. */
+struct StatsCounters
+{
+	unsigned long routes_expanded;/*!< Routes built by extending a route by one flight. */
+	unsigned long routes_pruned;/*!< Extensions dropped because they could not be cheaper than the cheapest known route. */
+	unsigned long routes_emitted;/*!< Routes that reached a destination of a search. */
+	unsigned long merge_pairs;/*!< Combinations of partial routes tested by the merge loops. */
+
+	/// Creates a new set of counters.
+	StatsCounters() :
+			routes_expanded(0), routes_pruned(0), routes_emitted(0), merge_pairs(0)
+	{
+	}
+};
+
+/// Gets the counters of the calling thread.
+/** The lookup is not free, so hot loops should look up the counters once and
+ *  keep a reference. */
+StatsCounters &stats_counters();
+
+/// Records the duration of a phase.
+/** Phases can be recorded concurrently. Phases that run several times (e.g.
+ *  one route search per pair of locations) are recorded separately and
+ *  distinguished by their label.
+ *
+ *  @param name     The phase name (e.g. "find_path").
+ *  @param label    Describes the instance of the phase (may be empty).
+ *  @param seconds  The wall time of the phase.
+ *  @param counters The hardware events of the phase (NULL if not counted). */
+void record_phase(const string &name, const string &label, double seconds,
+		const PerfValues *counters = NULL);
+
+/// Writes all recorded phases and the summed counters as JSON.
+/** @param filename The output file name.
+ *  @return         TRUE if the file could be written. */
+bool write_stats(const string &filename);
+
+/// Prints the hardware events of each phase name (summed over all instances).
+/** @param out Output stream. */
+void print_phase_counters(ostream &out);
+
+/// Measures the wall time of a phase.
+/** The phase starts when the timer is created and ends when it is destroyed.
+ *
+ *  If hardware performance counters are enabled, the events of ALL threads
+ *  between the start and the end of the phase are attributed to the phase.
+ *  Like the wall time, this includes the work of concurrent phases. */
+class PhaseTimer
+{
+private:
+	string name, label;
+	tbb::tick_count start;
+	PerfValues start_counters;
+
+	// Not copyable.
+	PhaseTimer(const PhaseTimer &t);
+	PhaseTimer &operator=(const PhaseTimer &t);
+
+public:
+	/// Starts a phase.
+	/** @param n The phase name.
+	 *  @param l Describes the instance of the phase. */
+	PhaseTimer(const string &n, const string &l = "") :
+			name(n), label(l), start(tbb::tick_count::now())
+	{
+		if (perf_counters_enabled())
+		{
+			start_counters = read_perf_counters();
+		}
+	}
+
+	/// Ends the phase and records its duration.
+	~PhaseTimer()
+	{
+		double seconds = (tbb::tick_count::now() - start).seconds();
+		if (perf_counters_enabled())
+		{
+			PerfValues counters = read_perf_counters();
+			counters -= start_counters;
+			record_phase(name, label, seconds, &counters);
+		}
+		else
+		{
+			record_phase(name, label, seconds);
+		}
+	}
+};
+
+}
+
+#endif /* STATS_H_ */
@@ -7,49 +7,196 @@
 
 #include <iostream>
 #include <limits>
+#include <utility>
+#include <algorithm>
+#include <cmath>
 
 #include "tbb/parallel_reduce.h"
+#include "tbb/task_arena.h"
 #include "tbb/blocked_range2d.h"
 #include "tbb/blocked_range3d.h"
 
 #include "tasks.h"
 #include "loop_bodies.h"
+#include "stats.h"
+#include "search_profile.h"
+#include "tracer.h"
 #include "../methods.h"
 
 using namespace std;
 using namespace oma;
 
+/// Number of chunks per thread into which a merge is split.
+#define MERGE_CHUNKS_PER_THREAD 8
+
+/// Minimum number of route combinations per chunk of a merge.
+#define MERGE_MIN_CHUNK_WORK 4096
+
+/// Computes the grain sizes of a merge.
+/** The grain sizes are chosen such that a merge is split into about
+ *  MERGE_CHUNKS_PER_THREAD chunks per thread, but each chunk covers at least
+ *  MERGE_MIN_CHUNK_WORK route combinations, so that small merges are not split
+ *  at all. All dimensions are scaled by the same factor, so the chunks have the
+ *  same shape as the whole merge.
+ *
+ *  @param sizes  The size of each dimension.
+ *  @param dims   The number of dimensions.
+ *  @param grains Output array for the grain size of each dimension. */
+static void merge_grain_sizes(const unsigned int *sizes, unsigned int dims,
+		unsigned int *grains)
+{
+	double work = 1;
+	for (unsigned int d = 0; d < dims; d++)
+	{
+		work *= sizes[d];
+	}
+
+	double chunk = work / (MERGE_CHUNKS_PER_THREAD * this_task_arena::max_concurrency());
+	if (chunk < MERGE_MIN_CHUNK_WORK) chunk = MERGE_MIN_CHUNK_WORK;
+
+	double factor = chunk < work ? pow(chunk / work, 1.0 / dims) : 1.0;
+	for (unsigned int d = 0; d < dims; d++)
+	{
+		grains[d] = (unsigned int) ceil(sizes[d] * factor);
+		if (grains[d] < 1) grains[d] = 1;
+	}
+}
+
 oma::FindPathTask::FindPathTask(string f, string t, int tmi, int tma, Parameters *p,
-		vector<Travel> *tr, Alliances *a)
+		vector<Travel> *tr, Alliances *a, concurrent_hash_map<string, Location> *lm)
 {
-	from = f;
+	from.push_back(f);
+	to.push_back(t);
+	parameters = p;
+
+	travels.push_back(tr);
+	alliances = a;
+	location_map = lm;
+
+	t_min = tmi;
+	t_max = tma;
+}
+
+oma::FindPathTask::FindPathTask(string f, const vector<string> &t, int tmi, int tma,
+		Parameters *p, const vector<Travels*> &tr, Alliances *a,
+		concurrent_hash_map<string, Location> *lm)
+{
+	from.push_back(f);
 	to = t;
 	parameters = p;
 
 	travels = tr;
 	alliances = a;
+	location_map = lm;
+
+	t_min = tmi;
+	t_max = tma;
+}
+
+oma::FindPathTask::FindPathTask(const vector<string> &f, string t, int tmi, int tma,
+		Parameters *p, const vector<Travels*> &tr, Alliances *a,
+		concurrent_hash_map<string, Location> *lm)
+{
+	from = f;
+	to.push_back(t);
+	parameters = p;
+
+	travels = tr;
+	alliances = a;
+	location_map = lm;
 
 	t_min = tmi;
 	t_max = tma;
 }
 
-tbb::task* oma::FindPathTask::execute()
+/** With several starting points, the search runs BACKWARD from the destination
+ *  point. In this case, the starting points are the targets of the search.
+ *
+ *  Routes that are known from the route cache are not searched again. All newly
+ *  found routes are put into the cache. */
+void oma::FindPathTask::operator()() const
 {
-	Travels temp_travels, all_paths;
-	CostRange min_range;
+	Travels temp_travels;
+	vector<string> ends, reachable;
+	bool forward = from.size() == 1;
+	string origin = forward ? from[0] : to[0];
+	unsigned int depth = 0;
+
+	string name = join_strings(from, ',') + " -> " + join_strings(to, ',');
+	PhaseTimer timer("find_path", name);
+	TraceScope trace("FindPathTask");
+
+	ends = forward ? to : from;
+	vector<bool> cached(ends.size(), false);
+
+	if (parameters->bidirectional_depth > 0 && from.size() == 1 && to.size() == 1)
+	{
+		depth = parameters->bidirectional_depth;
+	}
+
+	// Targets whose routes are known from an earlier search are not searched again.
+	// Also, do not even start searching for targets when the timetable tells us that
+	// there is no route between both locations.
+	for (unsigned int i = 0; i < ends.size(); i++)
+	{
+		string f = forward ? origin : ends[i], t = forward ? ends[i] : origin;
+
+		if (cached_routes(f, t, t_min, t_max, parameters, depth, travels[i]))
+		{
+			cached[i] = true;
+		}
+		else if (route_exists(f, t, t_min, t_max))
+		{
+			reachable.push_back(ends[i]);
+		}
+	}
+
+	if (reachable.size() == 0)
+	{
+		return;
+	}
 
-	fill_travel(&temp_travels, &all_paths, from, t_min, t_max, &min_range, to, alliances);
+	PathTargets targets(reachable);
+	use_timetable(&targets, forward, t_min, t_max);
+	if (parameters->search_profile_file != "")
+	{
+		targets.profile = new_search_profile(name, forward);
+	}
 
-	compute_path(to, &temp_travels, t_min, t_max, *parameters, &all_paths, &min_range,
-			alliances);
+	if (depth > 0)
+	{
+		compute_path_bidirectional(from[0], to[0], t_min, t_max, parameters, &targets,
+				alliances, location_map);
+	}
+	else
+	{
+		fill_travel(&temp_travels, &targets, origin, t_min, t_max, alliances, forward,
+				location_map);
+		compute_path(&targets, &temp_travels, t_min, t_max, parameters, alliances,
+				forward, location_map);
+	}
+
+	// The found routes have already been filtered while they were found. Only the
+	// routes that became too expensive since the last eviction are removed here.
+	PhaseTimer filter_timer("filter", origin);
+	for (unsigned int i = 0; i < ends.size(); i++)
+	{
+		int j = targets.find(ends[i]);
+		if (j < 0 || cached[i])
+		{
+			continue;
+		}
 
-	FilterPathsLoop fpl(&all_paths, travels, &min_range);
+		targets.take_travels(j, travels[i]);
 
-	if (all_paths.size() > 500) parallel_reduce(
-			blocked_range<unsigned int>(0, all_paths.size()), fpl);
-	else fpl(blocked_range<unsigned int>(0, all_paths.size()));
+		cache_routes(forward ? origin : ends[i], forward ? ends[i] : origin, t_min, t_max,
+				parameters, depth, travels[i]);
+	}
 
-	return NULL;
+	if (targets.profile != NULL)
+	{
+		targets.profile->finish();
+	}
 }
 
 oma::WorkHardTask::WorkHardTask(Travels *htc, Travels *cth, Solution *s, Alliances *a)
@@ -60,32 +207,40 @@ oma::WorkHardTask::WorkHardTask(Travels *htc, Travels *cth, Solution *s, Allianc
 	alliances = a;
 }
 
-tbb::task* oma::WorkHardTask::execute()
+void oma::WorkHardTask::operator()() const
 {
+	PhaseTimer timer("work_hard");
+	TraceScope trace("WorkHardTask");
+
 	// Return empty travel when one of the two partial routes is empty.
 	if (home_to_conference->size() == 0 || conference_to_home->size() == 0)
 	{
 		Travel empty;
 		solution->work_hard = empty;
 
-		return NULL;
+		return;
 	}
 
+	unsigned int sizes[2] =
+	{ (unsigned int) home_to_conference->size(), (unsigned int) conference_to_home->size() };
+	unsigned int grains[2];
+	merge_grain_sizes(sizes, 2, grains);
+
 	PathMergingOuterLoop pmol(home_to_conference, conference_to_home, alliances);
 	parallel_reduce(
-			blocked_range2d<unsigned int, unsigned int>(0, home_to_conference->size(), 0,
-					conference_to_home->size()), pmol);
+			blocked_range2d<unsigned int, unsigned int>(0, sizes[0], grains[0], 0, sizes[1],
+					grains[1]), pmol, simple_partitioner());
 
 	if (pmol.get_cheapest() != NULL)
 	{
-		solution->work_hard = *pmol.get_cheapest();
+		solution->work_hard = std::move(*pmol.get_cheapest());
 	}
-
-	return NULL;
 }
 
 oma::PlayHardTask::PlayHardTask(Travels *htv, Travels *vtc, Travels *cth, Travels *htc,
-		Travels *vth, Travels *ctv, Solution *s, unsigned int si, Alliances *a)
+		Travels *vth, Travels *ctv, Solution *s, unsigned int si, Alliances *a,
+		flow::receiver<unsigned int> *d) :
+		pending(2)
 {
 	home_to_conference = htc;
 	home_to_vacation = htv;
@@ -96,152 +251,573 @@ oma::PlayHardTask::PlayHardTask(Travels *htv, Travels *vtc, Travels *cth, Travel
 	alliances = a;
 	solution = s;
 	solution_index = si;
+	done = d;
 }
 
-tbb::task* oma::PlayHardTask::execute()
+void oma::PlayHardTask::add_merges(vector<PlayHardMergeTripleTask> &m)
 {
-	vector<Travel> all_travels, home_to_vacation_to_conference;
-	mutex rlock;
-	task_list merge_paths;
+	m.push_back(
+			PlayHardMergeTripleTask(this, solution_index, home_to_vacation,
+					vacation_to_conference, conference_to_home, alliances));
+	m.push_back(
+			PlayHardMergeTripleTask(this, solution_index, home_to_conference,
+					conference_to_vacation, vacation_to_home, alliances));
+}
 
-	merge_paths.push_back(
-			*new (task::allocate_child()) PlayHardMergeTripleTask(&all_travels, &rlock,
-					home_to_vacation, vacation_to_conference, conference_to_home,
-					alliances));
-	merge_paths.push_back(
-			*new (task::allocate_child()) PlayHardMergeTripleTask(&all_travels, &rlock,
-					home_to_conference, conference_to_vacation, vacation_to_home,
-					alliances));
+void oma::PlayHardTask::merge_done(Travel *t)
+{
+	if (t != NULL)
+	{
+		spin_mutex::scoped_lock l(results_lock);
+		results.push_back(std::move(*t));
+	}
 
-	set_ref_count(3);
-	task::spawn_and_wait_for_all(merge_paths);
+	if (--pending > 0)
+	{
+		return;
+	}
 
-	if (all_travels.size() == 0)
+	// Both merges are done, so no other thread accesses the results any more.
+	if (results.size() == 0)
 	{
 		Travel empty;
 		solution->add_play_hard(solution_index, empty);
 	}
-	else if (all_travels.size() == 1)
+	else if (results.size() == 1)
 	{
-		solution->add_play_hard(solution_index, all_travels[0]);
+		solution->add_play_hard(solution_index, results[0]);
 	}
 	else
 	{
-		if (all_travels[0].max_cost < all_travels[1].max_cost) solution->add_play_hard(
-				solution_index, all_travels[0]);
-		else solution->add_play_hard(solution_index, all_travels[1]);
+		// The order of the results depends on which merge finished first.
+		if (results[0].better_than(results[1])) solution->add_play_hard(
+				solution_index, results[0]);
+		else solution->add_play_hard(solution_index, results[1]);
+	}
+
+	done->try_put(solution_index);
+}
+
+/// Runs the merges of a "PlayHardScheduleTask".
+/** Each runner repeatedly takes the next merge that has not been started yet. Since
+ *  the merges are sorted by their work, the largest merges are started first. */
+class PlayHardMergeRunner
+{
+private:
+	vector<PlayHardMergeTripleTask> *merges;
+	std::atomic<unsigned int> *next;
+
+public:
+	/// Creates a new runner.
+	/** @param m The merges, sorted by descending work.
+	 *  @param n Index of the next merge that has not been started yet. */
+	PlayHardMergeRunner(vector<PlayHardMergeTripleTask> *m, std::atomic<unsigned int> *n) :
+			merges(m), next(n)
+	{
+	}
+
+	/// Runs merges until all merges have been started.
+	void operator()() const
+	{
+		unsigned int i;
+		while ((i = (*next)++) < merges->size())
+		{
+			(*merges)[i]();
+		}
+	}
+};
+
+/// Tests if a merge has more work than another one.
+static bool more_merge_work(const PlayHardMergeTripleTask &a, const PlayHardMergeTripleTask &b)
+{
+	return a.work() > b.work();
+}
+
+oma::PlayHardScheduleTask::PlayHardScheduleTask(vector<PlayHardTask*> *p)
+{
+	problems = p;
+}
+
+void oma::PlayHardScheduleTask::operator()() const
+{
+	vector<PlayHardMergeTripleTask> merges;
+	for (unsigned int i = 0; i < problems->size(); i++)
+	{
+		(*problems)[i]->add_merges(merges);
 	}
 
-	return NULL;
+	// A stable sort keeps the order of the vacation destinations for merges with equal work.
+	stable_sort(merges.begin(), merges.end(), more_merge_work);
+
+	std::atomic<unsigned int> next(0);
+	unsigned int runners = min((unsigned int) merges.size(),
+			(unsigned int) this_task_arena::max_concurrency());
+
+	task_group group;
+	for (unsigned int r = 0; r < runners; r++)
+	{
+		group.run(PlayHardMergeRunner(&merges, &next));
+	}
+	group.wait();
+}
+
+oma::WriteWorkHardTask::WriteWorkHardTask(Solution *s, Alliances *a, ofstream *o)
+{
+	solution = s;
+	alliances = a;
+	output = o;
+}
+
+void oma::WriteWorkHardTask::operator()() const
+{
+	PhaseTimer timer("output", "work_hard");
+	TraceScope trace("WriteWorkHardTask");
+	*output << "“Work Hard” Proposition :" << endl;
+	print_travel(solution->work_hard, alliances, *output);
+	output->flush();
+}
+
+oma::WritePlayHardTask::WritePlayHardTask(Solution *s, Parameters *p, Alliances *a,
+		ofstream *o)
+{
+	solution = s;
+	parameters = p;
+	alliances = a;
+	output = o;
 }
 
-oma::PlayHardMergeTripleTask::PlayHardMergeTripleTask(Travels *r, tbb::mutex *rl,
+flow::continue_msg oma::WritePlayHardTask::operator()(unsigned int i) const
+{
+	PhaseTimer timer("output", to_string(i));
+	TraceScope trace("WritePlayHardTask", i);
+	*output << "“Play Hard” Proposition " << (i + 1) << " : "
+			<< parameters->airports_of_interest[i] << endl;
+	print_travel(solution->play_hard[i], alliances, *output);
+	*output << endl;
+	output->flush();
+
+	return flow::continue_msg();
+}
+
+oma::PlayHardMergeTripleTask::PlayHardMergeTripleTask(PlayHardTask *p, unsigned int i,
 		Travels *t1, Travels *t2, Travels *t3, Alliances *a)
 {
-	results = r;
-	results_lock = rl;
+	problem = p;
+	solution_index = i;
 	travels1 = t1;
 	travels2 = t2;
 	travels3 = t3;
 	alliances = a;
 }
 
-tbb::task* oma::PlayHardMergeTripleTask::execute()
+unsigned long oma::PlayHardMergeTripleTask::work() const
 {
+	return (unsigned long) travels1->size() * travels2->size() * travels3->size();
+}
+
+void oma::PlayHardMergeTripleTask::operator()() const
+{
+	PhaseTimer timer("play_hard", to_string(solution_index));
+	TraceScope trace("PlayHardMergeTripleTask", solution_index);
+
+	unsigned int sizes[3] =
+	{ (unsigned int) travels1->size(), (unsigned int) travels2->size(),
+			(unsigned int) travels3->size() };
+	unsigned int grains[3];
+	merge_grain_sizes(sizes, 3, grains);
+
 	PathMergingTripleOuterLoop pmtol(travels1, travels2, travels3, alliances);
 	parallel_reduce(
-			blocked_range3d<unsigned int, unsigned int, unsigned int>(0, travels1->size(),
-					0, travels2->size(), 0, travels3->size()), pmtol);
+			blocked_range3d<unsigned int, unsigned int, unsigned int>(0, sizes[0], grains[0],
+					0, sizes[1], grains[1], 0, sizes[2], grains[2]), pmtol,
+			simple_partitioner());
 
-	if (pmtol.get_cheapest() != NULL)
-	{
-		mutex::scoped_lock l(*results_lock);
-		results->push_back(*pmtol.get_cheapest());
-	}
-
-	return NULL;
+	problem->merge_done(pmtol.get_cheapest());
 }
 
-ComputePathTask::ComputePathTask(Travel *t, string dst, Travels *ft, mutex *ftl,
-		unsigned long tmi, unsigned long tma, Parameters *p, Alliances *a, CostRange *mr,
-		concurrent_hash_map<string, Location> *lm, unsigned int l)
+ComputePathTask::ComputePathTask(const Travel &t, PathTargets *dst, bool fw,
+		unsigned long tmi, unsigned long tma, Parameters *p, Alliances *a,
+		concurrent_hash_map<string, Location> *lm, task_group *g, unsigned int l)
 {
 	travel = t;
-	destination = dst;
-	final_travels = ft;
-	final_travels_lock = ftl;
+	targets = dst;
+	forward = fw;
 	t_min = tmi;
 	t_max = tma;
 	parameters = p;
 	alliances = a;
-	min_range = mr;
 	location_map = lm;
+	group = g;
 	level = l;
 }
 
-/** This method spawns more compute path tasks. If a path to the destination
- *  is found, it is placed into the "final_travels" vector. */
-task* ComputePathTask::execute()
+/** A flight is a feasible follow-up of a travel, if it lies in the time window,
+ *  respects the maximum layover time, does not lead back to an already visited
+ *  city and if the extended travel can still be cheaper than the cheapest known
+ *  route (to any of the destinations that the travel can still reach). Of course,
+ *  the travel must not be longer than the hop limit.
+ *
+ *  In backward mode, the flight is put in front of the travel, so it needs to
+ *  land before the travel's first flight takes off. */
+bool ComputePathTask::is_feasible(const Travel *t, Flight *flight, Cost b,
+		StatsCounters &c, SearchLevel *l) const
 {
-	Flight *current_city = &(travel->flights.back());
+	if (parameters->max_hops > 0 && t->size() >= parameters->max_hops)
+	{
+		if (l != NULL) l->failed[PREDICATE_MAX_HOPS]++;
+		return false;
+	}
 
-	concurrent_hash_map<string, Location>::const_accessor a;
-	if (!location_map->find(a, current_city->to))
+	if (flight->take_off_time < t_min || flight->land_time > t_max)
+	{
+		if (l != NULL) l->failed[PREDICATE_TIME_WINDOW]++;
+		return false;
+	}
+
+	if (discounted(flight->cost, 70) + t->min_cost > b)
+	{
+		if (l != NULL) l->failed[PREDICATE_COST_ESTIMATE]++;
+		c.routes_pruned++;
+		return false;
+	}
+
+	// The flights that need to connect (the earlier one lands before the later one).
+	const Flight *earlier = forward ? &(t->last_flight()) : flight;
+	const Flight *later = forward ? flight : &(t->first_flight());
+	if (later->take_off_time <= earlier->land_time
+			|| later->take_off_time - earlier->land_time > parameters->max_layover_time)
+	{
+		if (l != NULL) l->failed[PREDICATE_CONNECTION]++;
+		return false;
+	}
+
+	if (!nerver_traveled_to(*t, forward ? flight->to : flight->from))
+	{
+		if (l != NULL) l->failed[PREDICATE_VISITED]++;
+		return false;
+	}
+
+	return true;
+}
+
+/** In forward mode, the flight is appended to the travel. In backward mode,
+ *  it is put in front of the travel. In both cases, the memory of the output
+ *  travel is reused.
+ *
+ *  The minimal costs of the extended travel are exact except for its end
+ *  flights, so they are checked again (this is more precise than the estimate
+ *  in "is_feasible"). */
+bool ComputePathTask::extend(const Travel *t, Flight *flight, Travel *o, Cost b,
+		StatsCounters &c, SearchLevel *l) const
+{
+	c.routes_expanded++;
+
+	if (forward)
+	{
+		*o = *t;
+		o->add_flight(*flight, alliances);
+	}
+	else
+	{
+		o->clear();
+		o->add_flight(*flight, alliances);
+		o->merge_travel(t, alliances);
+	}
+
+	if (o->min_cost > b)
+	{
+		if (l != NULL) l->failed[PREDICATE_COST_EXACT]++;
+		c.routes_pruned++;
+		return false;
+	}
+
+	if (l != NULL) l->accepted++;
+	return true;
+}
+
+/** This method looks up the flights that may extend a travel at its open end
+ *  (i.e. the outgoing flights of its last city in forward mode and the incoming
+ *  flights of its first city in backward mode). */
+const vector<Flight> *ComputePathTask::follow_up_flights(const Travel *t,
+		concurrent_hash_map<string, Location>::const_accessor &a) const
+{
+	const string &city = forward ? t->last_flight().to : t->first_flight().from;
+	if (!location_map->find(a, city))
 	{
-		cerr << "Fehler: Stadt " << current_city->to << " ist nicht bekannt." << endl;
 		return NULL;
 	}
 
-	const Location *from = &(a->second);
+	return forward ? &(a->second.outgoing_flights) : &(a->second.incoming_flights);
+}
 
-	tbb::task_list tl;
-	unsigned int tl_count = 0;
+/** The level of a travel in the profile is its number of flights. */
+SearchLevel *ComputePathTask::profile_level(const Travel *t, unsigned int edges) const
+{
+	if (targets->profile == NULL)
+	{
+		return NULL;
+	}
+
+	SearchLevel *l = &(targets->profile->level(t->size()));
+	l->routes++;
+	l->edges += edges;
+	return l;
+}
+
+/** This method explores all follow-up travels of a travel by a (sequential)
+ *  depth-first-search. It is used below the task cutoff level, where subtrees are
+ *  usually too small to justify the overhead of creating new tasks.
+ *
+ *  All follow-up travels of one level are built in the same travel object, which
+ *  reuses its memory. Travels that end the search are moved into the targets. */
+void ComputePathTask::explore(const Travel *t) const
+{
+	concurrent_hash_map<string, Location>::const_accessor a;
+	const vector<Flight> *flights = follow_up_flights(t, a);
+	if (flights == NULL)
+	{
+		return;
+	}
 
-	unsigned int s = from->outgoing_flights.size();
+	Travel new_travel;
+	StatsCounters &c = stats_counters();
+	SearchLevel *l = profile_level(t, flights->size());
+	Cost b = targets->bound(t);
+	unsigned int s = flights->size();
 	for (unsigned int i = 0; i < s; i++)
 	{
-		Flight *flight = (Flight*) &(from->outgoing_flights[i]);
-		if (flight->take_off_time >= t_min && flight->land_time <= t_max
-				&& (flight->take_off_time > current_city->land_time)
-				&& flight->take_off_time - current_city->land_time
-						<= parameters->max_layover_time
-				&& nerver_traveled_to(*travel, flight->to)
-				&& flight->cost * 0.7 + travel->min_cost <= min_range->max)
+		Flight *flight = (Flight*) &((*flights)[i]);
+		if (is_feasible(t, flight, b, c, l) && extend(t, flight, &new_travel, b, c, l))
 		{
+			int target = targets->find(forward ? flight->to : flight->from);
+			bool follow = (target < 0 || targets->size() > 1)
+					&& (parameters->max_hops == 0
+							|| new_travel.size() < parameters->max_hops);
 
-			Travel *new_travel = new Travel(*travel);
-			new_travel->add_flight(*flight, alliances);
+			if (target >= 0 && follow)
+			{
+				targets->add_travel(target, &new_travel);
+			}
+			else if (target >= 0)
+			{
+				targets->move_travel(target, &new_travel);
+			}
 
-			if (flight->to == destination)
+			if (follow)
 			{
-				mutex::scoped_lock lock(*final_travels_lock);
+				explore(&new_travel);
+			}
+		}
+	}
+}
+
+/** This method spawns more compute path tasks. If a path to a destination
+ *  is found, it is added to the destination's route vector.
+ *
+ *  Below the task cutoff level (see "Parameters::task_cutoff_level"), no more
+ *  tasks are spawned. Instead, the remaining subtree is explored sequentially. */
+void ComputePathTask::operator()() const
+{
+	TraceScope trace("ComputePathTask", level);
 
-				final_travels->push_back(*new_travel);
-				min_range->from_travel(new_travel);
+	if (level >= parameters->task_cutoff_level)
+	{
+		explore(&travel);
+		return;
+	}
+
+	concurrent_hash_map<string, Location>::const_accessor a;
+	const vector<Flight> *flights = follow_up_flights(&travel, a);
+	if (flights == NULL)
+	{
+		cerr << "Fehler: Stadt "
+				<< (forward ? travel.last_flight().to : travel.first_flight().from)
+				<< " ist nicht bekannt." << endl;
+		return;
+	}
+
+	// Follow-up tasks get their own copies of the extended travels, so all of them
+	// are built in the same travel object.
+	Travel new_travel;
+	StatsCounters &c = stats_counters();
+	SearchLevel *l = profile_level(&travel, flights->size());
+	Cost b = targets->bound(&travel);
+	unsigned int s = flights->size();
+	for (unsigned int i = 0; i < s; i++)
+	{
+		Flight *flight = (Flight*) &((*flights)[i]);
+		if (is_feasible(&travel, flight, b, c, l)
+				&& extend(&travel, flight, &new_travel, b, c, l))
+		{
+			int target = targets->find(forward ? flight->to : flight->from);
+			bool follow = (target < 0 || targets->size() > 1)
+					&& (parameters->max_hops == 0
+							|| new_travel.size() < parameters->max_hops);
+
+			if (target >= 0 && follow)
+			{
+				targets->add_travel(target, &new_travel);
 			}
-			else
+			else if (target >= 0)
 			{
-				tl.push_back(
-						*new (tbb::task::allocate_child()) ComputePathTask(new_travel,
-								destination, final_travels, final_travels_lock, t_min,
-								t_max, parameters, alliances, min_range, location_map,
-								level + 1));
-				tl_count++;
+				targets->move_travel(target, &new_travel);
+			}
+
+			if (follow)
+			{
+				group->run(
+						ComputePathTask(new_travel, targets, forward, t_min, t_max,
+								parameters, alliances, location_map, group, level + 1));
 			}
 		}
 	}
+}
+
+HalfPathTask::HalfPathTask(string o, string op, bool fw, RoutesByCity *r, PathTargets *dst,
+		unsigned long tmi, unsigned long tma, Parameters *p, Alliances *a,
+		concurrent_hash_map<string, Location> *lm)
+{
+	origin = o;
+	opposite = op;
+	forward = fw;
+	routes = r;
+	targets = dst;
+	t_min = tmi;
+	t_max = tma;
+	parameters = p;
+	alliances = a;
+	location_map = lm;
+}
+
+/** In forward mode, the flight is appended to the route and needs to take off
+ *  after the last flight landed. In backward mode, the flight is prepended to
+ *  the route and needs to land before the first flight takes off. In both cases,
+ *  the layover time must not exceed the maximum layover time. */
+bool HalfPathTask::extend(Travel *t, Flight *f, Travel *o, StatsCounters &c) const
+{
+	if (f->take_off_time < t_min || f->land_time > t_max)
+	{
+		return false;
+	}
 
-	// Delete input travel before starting new tasks. We don't need it anymore.
-	if (level > 0)
+	if (discounted(f->cost, 70) + (t == NULL ? 0 : t->min_cost) > targets->ranges[0].max)
 	{
-		delete travel;
+		c.routes_pruned++;
+		return false;
 	}
 
-	if (tl_count > 0)
+	if (t == NULL)
 	{
-		set_ref_count(tl_count + 1);
-		tbb::task::spawn_and_wait_for_all(tl);
+		c.routes_expanded++;
+		o->add_flight(*f, alliances);
+		return true;
 	}
 
-	return NULL;
+	if (forward)
+	{
+		const Flight *l = &(t->last_flight());
+		if (f->take_off_time <= l->land_time
+				|| f->take_off_time - l->land_time > parameters->max_layover_time
+				|| !nerver_traveled_to(*t, f->to))
+		{
+			return false;
+		}
+
+		*o = *t;
+		o->add_flight(*f, alliances);
+	}
+	else
+	{
+		const Flight *n = &(t->first_flight());
+		if (n->take_off_time <= f->land_time
+				|| n->take_off_time - f->land_time > parameters->max_layover_time
+				|| !nerver_traveled_to(*t, f->from))
+		{
+			return false;
+		}
+
+		o->add_flight(*f, alliances);
+		o->merge_travel(t, alliances);
+	}
+
+	// The exact minimal costs may exceed the bound, even if the estimate above did not.
+	c.routes_expanded++;
+	if (o->min_cost > targets->ranges[0].max)
+	{
+		c.routes_pruned++;
+		return false;
+	}
+
+	return true;
+}
+
+/** This method explores the routes level by level. Each level contains routes
+ *  that are one flight longer than the routes of the previous level. */
+void HalfPathTask::operator()() const
+{
+	TraceScope trace("HalfPathTask");
+	Travels current, next;
+	unsigned int depth = parameters->bidirectional_depth;
+	StatsCounters &c = stats_counters();
+
+	// Each half of a joined route has at least one flight, so the half routes need
+	// at most "max_hops - 1" flights (the first level also finds direct flights).
+	if (parameters->max_hops > 0 && depth > parameters->max_hops - 1)
+	{
+		depth = max(parameters->max_hops - 1, 1u);
+	}
+
+	for (unsigned int level = 0; level < depth; level++)
+	{
+		unsigned int s = (level == 0) ? 1 : current.size();
+		for (unsigned int i = 0; i < s; i++)
+		{
+			Travel *t = (level == 0) ? NULL : &(current[i]);
+			string city = origin;
+			if (t != NULL)
+			{
+				city = forward ? t->last_flight().to : t->first_flight().from;
+			}
+
+			concurrent_hash_map<string, Location>::const_accessor a;
+			if (!location_map->find(a, city))
+			{
+				continue;
+			}
+
+			const vector<Flight> *flights =
+					forward ? &(a->second.outgoing_flights) : &(a->second.incoming_flights);
+
+			for (unsigned int j = 0; j < flights->size(); j++)
+			{
+				Flight *f = (Flight*) &((*flights)[j]);
+				const string &end = forward ? f->to : f->from;
+
+				// Routes through the opposite end are not explored. The only exception
+				// are direct flights, which are complete routes on their own.
+				if (end == opposite)
+				{
+					if (forward && level == 0)
+					{
+						Travel d;
+						if (extend(t, f, &d, c))
+						{
+							targets->move_travel(0, &d);
+						}
+					}
+					continue;
+				}
+
+				Travel n;
+				if (extend(t, f, &n, c))
+				{
+					if (level + 1 < depth) next.push_back(n);
+					(*routes)[end].push_back(std::move(n));
+				}
+			}
+		}
+
+		current.swap(next);
+		next.clear();
+	}
 }
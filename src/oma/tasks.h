@@ -9,18 +9,93 @@
 #define TASKS_H_
 
 #include <vector>
-#include "tbb/task.h"
-#include "tbb/mutex.h"
+#include <fstream>
+#include <atomic>
+#include "tbb/task_group.h"
+#include "tbb/spin_mutex.h"
+#include "tbb/flow_graph.h"
 #include "tbb/concurrent_hash_map.h"
 
 #include "../types.h"
 #include "../methods.h"
+#include "route_store.h"
+#include "stats.h"
+#include "search_profile.h"
 
 using namespace tbb;
 
 namespace oma
 {
 
+/// Adapts a task to the body of a flow graph node.
+/** The tasks in this file are plain function objects that can be run in a
+ *  "tbb::task_group". This adapter allows to use them as the body of a
+ *  "tbb::flow::continue_node", which is executed as soon as all of its
+ *  predecessors in the flow graph have completed. */
+template<typename T>
+class GraphNodeBody
+{
+private:
+	T task;
+
+public:
+	/// Creates a new node body.
+	/** @param t The task to be executed. */
+	GraphNodeBody(const T &t) :
+			task(t)
+	{
+	}
+
+	/// Executes the task.
+	flow::continue_msg operator()(const flow::continue_msg &m) const
+	{
+		task();
+		return m;
+	}
+};
+
+/// Adapts a task to the body of a flow graph node that runs it in a task arena.
+/** Like "GraphNodeBody", but the task (and all parallel work it starts) is run in
+ *  another task arena, e.g. the arena of a NUMA node. */
+template<typename T>
+class ArenaNodeBody
+{
+private:
+	T task;
+	task_arena *arena;
+
+public:
+	/// Creates a new node body.
+	/** @param t The task to be executed.
+	 *  @param a The arena in which the task is run (NULL = the current arena). */
+	ArenaNodeBody(const T &t, task_arena *a) :
+			task(t), arena(a)
+	{
+	}
+
+	/// Executes the task.
+	flow::continue_msg operator()(const flow::continue_msg &m) const
+	{
+		if (arena != NULL) arena->execute(task);
+		else task();
+		return m;
+	}
+};
+
+/// A flow graph node that runs a task as soon as all predecessors have completed.
+typedef flow::continue_node<flow::continue_msg> GraphNode;
+
+/// Sequence numbers for "tbb::flow::sequencer_node"s that order result indices.
+class IndexSequence
+{
+public:
+	/// Returns the sequence number of an index (i.e. the index itself).
+	size_t operator()(unsigned int i) const
+	{
+		return i;
+	}
+};
+
 /// Computes all possible paths between two locations.
 /** This task computes all possible paths between two locations. This is done
  *  by performing a breadth-first-search on the flight graph. Routes to the
@@ -28,15 +103,19 @@ namespace oma
  *  potentially cheaper than the cheapest known solution (there is a small window
  *  if uncertainty because the flight discounts are not completely known in
  *  advance, so instead of fixed costs we use "cost ranges" consisting of the
- *  minimum and maximum possible costs of a route). */
-class FindPathTask: public tbb::task
+ *  minimum and maximum possible costs of a route).
+ *
+ *  A task can also search for routes to several destinations (or from several
+ *  starting points) at once. Each of these keeps its own cost range. */
+class FindPathTask
 {
 private:
-	string from, to;
+	vector<string> from, to;
 	Parameters *parameters;
-	Travels *travels;
+	vector<Travels*> travels;
 	int t_min, t_max;
 	Alliances *alliances;
+	concurrent_hash_map<string, Location> *location_map;
 
 public:
 
@@ -47,12 +126,45 @@ public:
 	 *  @param tma Maximum departure time.
 	 *  @param p Input parameters.
 	 *  @param tr Output travel vector.
-	 *  @param a All alliances. */
+	 *  @param a All alliances.
+	 *  @param lm The flight graph (e.g. the replica of a NUMA node). */
 	FindPathTask(string f, string t, int tmi, int tma, Parameters *p, Travels *tr,
-			Alliances *a);
+			Alliances *a, concurrent_hash_map<string, Location> *lm);
+
+	/// Creates a new task with several destinations.
+	/** All destinations are searched at once, i.e. each route from the starting
+	 *  point is explored only once, regardless of the number of destinations.
+	 *
+	 *  @param f Starting point.
+	 *  @param t Destination points.
+	 *  @param tmi Minimum departure time.
+	 *  @param tma Maximum departure time.
+	 *  @param p Input parameters.
+	 *  @param tr Output travel vectors (one for each destination).
+	 *  @param a All alliances.
+	 *  @param lm The flight graph (e.g. the replica of a NUMA node). */
+	FindPathTask(string f, const vector<string> &t, int tmi, int tma, Parameters *p,
+			const vector<Travels*> &tr, Alliances *a,
+			concurrent_hash_map<string, Location> *lm);
+
+	/// Creates a new task with several starting points.
+	/** All starting points are searched at once by a backward search from the
+	 *  destination point.
+	 *
+	 *  @param f Starting points.
+	 *  @param t Destination point.
+	 *  @param tmi Minimum departure time.
+	 *  @param tma Maximum departure time.
+	 *  @param p Input parameters.
+	 *  @param tr Output travel vectors (one for each starting point).
+	 *  @param a All alliances.
+	 *  @param lm The flight graph (e.g. the replica of a NUMA node). */
+	FindPathTask(const vector<string> &f, string t, int tmi, int tma, Parameters *p,
+			const vector<Travels*> &tr, Alliances *a,
+			concurrent_hash_map<string, Location> *lm);
 
 	/// Executes the "find path" task.
-	task* execute();
+	void operator()() const;
 };
 
 /// Solves the "work hard" problem.
@@ -61,7 +173,7 @@ public:
  *
  *    1. merges these paths to possible solutions for the "work hard" problem, AND
  *    2. finds the cheapest of these solutions. */
-class WorkHardTask: public tbb::task
+class WorkHardTask
 {
 private:
 	Travels *home_to_conference, *conference_to_home;
@@ -82,16 +194,23 @@ public:
 	/** Merges the two sets of input routes (by building the carthesian product and selecting
 	 *  all items where arrival time of the last flight of set A is less then departure time
 	 *  of the first flight of set B) and finds the cheapest of the possible routes. */
-	task* execute();
+	void operator()() const;
 };
 
+class PlayHardMergeTripleTask;
+
 /// Solves ONE specific of the "play hard" problems.
-/** This task accepts sets of possible paths from "home to conference", "home to vacation",
- *  "vacation to conference" and each vice versa as input parameters and then
+/** This object accepts sets of possible paths from "home to conference", "home to vacation",
+ *  "vacation to conference" and each vice versa as input parameters. These paths
+ *  are merged to possible solutions for ONE of the "play hard" problems by two
+ *  "PlayHardMergeTripleTask"s (home -> vacation -> conference -> home and
+ *  home -> conference -> vacation -> home). The merges are not run by this object
+ *  itself, but by a "PlayHardScheduleTask" together with the merges of all other
+ *  "play hard" problems. When both merges are done, this object
  *
- *    1. merges these paths to possible solutions for ONE of the "play hard" problems, AND
- *    2. finds the cheapest of these solutions. */
-class PlayHardTask: public tbb::task
+ *    1. finds the cheapest of the two solutions, AND
+ *    2. passes the index of the solution on to the writer. */
+class PlayHardTask
 {
 private:
 	Travels *home_to_vacation, *vacation_to_conference, *conference_to_home,
@@ -99,6 +218,15 @@ private:
 	Solution *solution;
 	unsigned int solution_index;
 	Alliances *alliances;
+	flow::receiver<unsigned int> *done;
+
+	Travels results;
+	spin_mutex results_lock;
+	std::atomic<unsigned int> pending;
+
+	// Not copyable.
+	PlayHardTask(const PlayHardTask &t);
+	PlayHardTask &operator=(const PlayHardTask &t);
 
 public:
 
@@ -114,70 +242,167 @@ public:
 	 *  @param i   Index at which this solution should be inserted into the solution vector.
 	 *             The order of insertion is quite important, otherwise a simple ->push_back
 	 *             would have sufficed.
-	 *  @param a   A pointer to the alliances vector. */
+	 *  @param a   A pointer to the alliances vector.
+	 *  @param d   Receiver to which "i" is passed when the solution is known. */
 	PlayHardTask(Travels *htv, Travels *vtc, Travels *cth, Travels *htc, Travels *vth,
-			Travels *ctv, Solution *s, unsigned int i, Alliances *a);
+			Travels *ctv, Solution *s, unsigned int i, Alliances *a,
+			flow::receiver<unsigned int> *d);
+
+	/// Adds the two merges of this problem to a list of merges.
+	/** @param m The list of merges. */
+	void add_merges(vector<PlayHardMergeTripleTask> &m);
+
+	/// Stores the result of one of the two merges.
+	/** After the second merge, the cheapest result is stored in the solution object.
+	 *
+	 *  @param t The cheapest route found by the merge (which is moved), or NULL. */
+	void merge_done(Travel *t);
+};
 
-	/// Executes the "play hard" task.
-	/** Merges the three sets of input routes (by building the carthesian product and selecting
-	 *  all items where arrival time of the last flight of set A is less then departure time
-	 *  of the first flight of set B) and finds the cheapest of the possible routes. */
-	task* execute();
+/// Solves all "play hard" problems.
+/** The work of the merges of the "play hard" problems ranges from trivial to cubic
+ *  in the number of partial routes. If they are simply started all at once, a large
+ *  merge that happens to be started last determines the runtime. Therefore, this
+ *  task estimates the work of each merge (see "PlayHardMergeTripleTask::work") and
+ *  starts the merges in descending order of their work: One worker per thread takes
+ *  the largest merge that has not been started yet, until all merges are done. */
+class PlayHardScheduleTask
+{
+private:
+	vector<PlayHardTask*> *problems;
+
+public:
+
+	/// Creates a new "play hard" scheduling task.
+	/** @param p The "play hard" problems. */
+	PlayHardScheduleTask(vector<PlayHardTask*> *p);
+
+	/// Executes the "play hard" scheduling task.
+	void operator()() const;
+};
+
+/// Writes the "work hard" solution.
+/** This task writes the "work hard" solution into the output file. It is run as
+ *  soon as the "work hard" problem is solved, regardless of the "play hard"
+ *  problems, which may still be worked on. */
+class WriteWorkHardTask
+{
+private:
+	Solution *solution;
+	Alliances *alliances;
+	ofstream *output;
+
+public:
+
+	/// Creates a new "write work hard" task.
+	/** @param s The solution object.
+	 *  @param a A pointer to the alliances vector.
+	 *  @param o The output stream. */
+	WriteWorkHardTask(Solution *s, Alliances *a, ofstream *o);
+
+	/// Executes the "write work hard" task.
+	void operator()() const;
+};
+
+/// Writes "play hard" solutions.
+/** This task writes a single "play hard" solution into the output file. The
+ *  solutions need to be written in the order of the vacation destinations, so
+ *  this task needs to be run serially and in order (e.g. behind a
+ *  "tbb::flow::sequencer_node"). */
+class WritePlayHardTask
+{
+private:
+	Solution *solution;
+	Parameters *parameters;
+	Alliances *alliances;
+	ofstream *output;
+
+public:
+
+	/// Creates a new "write play hard" task.
+	/** @param s The solution object.
+	 *  @param p Input parameters.
+	 *  @param a A pointer to the alliances vector.
+	 *  @param o The output stream. */
+	WritePlayHardTask(Solution *s, Parameters *p, Alliances *a, ofstream *o);
+
+	/// Writes the "play hard" solution with a specific index.
+	/** @param i The index of the "play hard" solution. */
+	flow::continue_msg operator()(unsigned int i) const;
 };
 
 /// Task for creating a specific subset of the "play hard" solution.
 /** This task creates a specific subset of the "play hard" solution (i.e. either
  *  "home -> vacation -> conference -> home" or "home -> conference -> vacation-> home"). */
-class PlayHardMergeTripleTask: public tbb::task
+class PlayHardMergeTripleTask
 {
 private:
 	Travels *travels1, *travels2, *travels3;
-	Travels *results;
-	mutex *results_lock;
+	PlayHardTask *problem;
+	unsigned int solution_index;
 	Alliances *alliances;
 
 public:
 
 	/// Creates a new "play hard merge" task.
-	/** @param r Output result vector.
-	 *  @param rl Mutex for synchronizing access on output result vector.
+	/** @param p  The "play hard" problem to which the result is passed.
+	 *  @param i  Index of the "play hard" problem.
 	 *  @param t1 Input travel vector #1.
 	 *  @param t2 Input travel vector #2.
 	 *  @param t3 Input travel vector #3.
 	 *  @param a Alliances. */
-	PlayHardMergeTripleTask(Travels *r, tbb::mutex *rl, Travels *t1, Travels *t2,
+	PlayHardMergeTripleTask(PlayHardTask *p, unsigned int i, Travels *t1, Travels *t2,
 			Travels *t3, Alliances *a);
 
+	/// Estimates the work of this merge.
+	/** The partial routes have already been filtered, so the number of their
+	 *  combinations is a good estimate for the work of the merge.
+	 *
+	 *  @return The product of the sizes of the three input travel vectors. */
+	unsigned long work() const;
+
 	/// Executes the "play hard merge" task.
-	task* execute();
+	/** The merge is split into chunks whose grain sizes depend on its work. */
+	void operator()() const;
 };
 
 /// Task for computing a path between two different locations.
 /** This task recursively computes possible paths between two different
  *  locations. It accepts a single travel as input parameter and creates new
- *  tasks, each exploring a different follow-up travel of the input travel.
+ *  tasks, each exploring a different follow-up travel of the input travel. All
+ *  tasks of one search are run in the same task group, so that the caller only
+ *  needs to wait for this task group.
  *
  *  In comparison to the reference implementation, this algorithms performs a
  *  breadth-first-search (instead of a depth-first-search). This is more
  *  efficient, since the optimal route is probably rather short and should
- *  be found quicker using BFS. */
-class ComputePathTask: public tbb::task
+ *  be found quicker using BFS.
+ *
+ *  Deep in the search tree, the subtrees are usually small. Below a configurable
+ *  recursion level, the task therefore switches to a sequential depth-first-search
+ *  in order to avoid the task creation overhead. Optionally, the number of flights
+ *  per route can be limited.
+ *
+ *  A search may have several destinations. In this case, routes are extended
+ *  beyond a destination, since they might still lead to one of the others.
+ *
+ *  The search can also run backward (using the incoming flights of each city).
+ *  Then, the routes grow from the destination towards the "targets", which are
+ *  the possible origins of the routes. */
+class ComputePathTask
 {
 private:
 	/// Recursion level
 	unsigned int level;
 
-	/// Input travel
-	Travel *travel;
-
-	/// Name of destination location.
-	std::string destination;
+	/// Input travel (each task has its own copy).
+	Travel travel;
 
-	/// Output travel vector
-	Travels *final_travels;
+	/// Destinations (and output travel vectors).
+	PathTargets *targets;
 
-	/// Mutex for synchronizing access on output travel vector.
-	mutex *final_travels_lock;
+	/// TRUE for a forward search, FALSE for a backward search.
+	bool forward;
 
 	/// Minimum flight time.
 	unsigned long t_min;
@@ -191,31 +416,141 @@ private:
 	/// Alliance list.
 	Alliances *alliances;
 
-	/// Minimum cost range.
-	CostRange *min_range;
-
 	/// Location map.
 	tbb::concurrent_hash_map<std::string, Location> *location_map;
 
+	/// Task group in which follow-up tasks are run.
+	task_group *group;
+
+	/// Tests if a flight is a feasible follow-up of a travel.
+	/** @param t      The travel.
+	 *  @param flight The follow-up flight.
+	 *  @param b      Cost bound of the travel (see "PathTargets::bound").
+	 *  @param c      Counters of the calling thread.
+	 *  @param l      Profile of the travel's level (NULL if the search is not profiled).
+	 *  @return       TRUE if the flight may be added to the travel. */
+	bool is_feasible(const Travel *t, Flight *flight, Cost b, StatsCounters &c,
+			SearchLevel *l) const;
+
+	/// Extends a travel by one flight.
+	/** @param t      The travel.
+	 *  @param flight The follow-up flight.
+	 *  @param o      Output travel.
+	 *  @param b      Cost bound of the travel (see "PathTargets::bound").
+	 *  @param c      Counters of the calling thread.
+	 *  @param l      Profile of the travel's level (NULL if the search is not profiled).
+	 *  @return       FALSE if the extended travel cannot be cheaper than the
+	 *                cheapest known route anymore. */
+	bool extend(const Travel *t, Flight *flight, Travel *o, Cost b, StatsCounters &c,
+			SearchLevel *l) const;
+
+	/// Records that a travel is extended in the search profile.
+	/** @param t     The travel.
+	 *  @param edges Number of follow-up flights that are tested.
+	 *  @return      Profile of the travel's level (NULL if the search is not profiled). */
+	SearchLevel *profile_level(const Travel *t, unsigned int edges) const;
+
+	/// Gets all flights that may extend a travel.
+	/** @param t The travel.
+	 *  @param a Accessor for the location map (must be held while the flights are used).
+	 *  @return  The flights, or NULL if the city is unknown. */
+	const vector<Flight> *follow_up_flights(const Travel *t,
+			tbb::concurrent_hash_map<std::string, Location>::const_accessor &a) const;
+
+	/// Explores all follow-up travels of a travel without spawning tasks.
+	/** @param t The travel. */
+	void explore(const Travel *t) const;
+
 public:
 	/// Constructor.
 	/** @param t   Input travel.
-	 *  @param dst Name of destination.
-	 *  @param ft  Output vector.
-	 *  @param ftl Output vector mutex.
+	 *  @param dst Destinations (and output vectors).
+	 *  @param fw  TRUE for forward search, FALSE for backward search.
 	 *  @param tmi Minimum departure time.
 	 *  @param tma Maximum departure time.
 	 *  @param p   Program parameters.
 	 *  @param a   Alliance list.
-	 *  @param mr  Minimum cost range.
 	 *  @param lm  Location map.
+	 *  @param g   Task group in which follow-up tasks are run.
 	 *  @param r   Recursion level. */
-	ComputePathTask(Travel *t, std::string dst, Travels *ft, mutex *ftl,
-			unsigned long tmi, unsigned long tma, Parameters *p, Alliances *a,
-			CostRange *mr, tbb::concurrent_hash_map<string, Location> *lm, unsigned int l = 0);
+	ComputePathTask(const Travel &t, PathTargets *dst, bool fw, unsigned long tmi,
+			unsigned long tma, Parameters *p, Alliances *a,
+			tbb::concurrent_hash_map<string, Location> *lm, task_group *g,
+			unsigned int l = 0);
 
 	/// Executes the "Compute Path" task.
-	task* execute();
+	void operator()() const;
+};
+
+/// Task for one half of a bidirectional path search.
+/** This task explores all routes of up to "parameters->bidirectional_depth" flights
+ *  that either start at a given location (forward search, using outgoing flights)
+ *  or end at a given location (backward search, using incoming flights). The
+ *  explored routes are grouped by the city at their open end, so that the routes
+ *  of a forward and a backward search can be joined later.
+ *
+ *  Routes never pass through the opposite end of the search. In forward mode,
+ *  direct flights to the opposite end are complete routes and are added to the
+ *  search's destination immediately. */
+class HalfPathTask
+{
+private:
+	/// Location where the search starts.
+	std::string origin;
+
+	/// Location at the other end of the route.
+	std::string opposite;
+
+	/// TRUE for a forward search, FALSE for a backward search.
+	bool forward;
+
+	/// Output routes, grouped by city.
+	RoutesByCity *routes;
+
+	/// Destination of the whole search (complete routes are stored here).
+	PathTargets *targets;
+
+	/// Minimum flight time.
+	unsigned long t_min;
+
+	/// Maximum flight time.
+	unsigned long t_max;
+
+	/// Program parameters.
+	Parameters *parameters;
+
+	/// Alliance list.
+	Alliances *alliances;
+
+	/// Location map.
+	tbb::concurrent_hash_map<std::string, Location> *location_map;
+
+	/// Tries to extend a route by one flight.
+	/** @param t Input travel (NULL to start a new route).
+	 *  @param f The flight to be added.
+	 *  @param o Output travel.
+	 *  @param c Counters of the calling thread.
+	 *  @return  TRUE if the flight could be added. */
+	bool extend(Travel *t, Flight *f, Travel *o, StatsCounters &c) const;
+
+public:
+	/// Constructor.
+	/** @param o   Location where the search starts.
+	 *  @param op  Location at the other end of the route.
+	 *  @param fw  TRUE for forward search, FALSE for backward search.
+	 *  @param r   Output routes.
+	 *  @param dst Destination of the whole search (and output for complete routes).
+	 *  @param tmi Minimum departure time.
+	 *  @param tma Maximum departure time.
+	 *  @param p   Program parameters.
+	 *  @param a   Alliance list.
+	 *  @param lm  Location map. */
+	HalfPathTask(std::string o, std::string op, bool fw, RoutesByCity *r, PathTargets *dst,
+			unsigned long tmi, unsigned long tma, Parameters *p, Alliances *a,
+			tbb::concurrent_hash_map<string, Location> *lm);
+
+	/// Executes the half search.
+	void operator()() const;
 };
 
 }
@@ -0,0 +1,115 @@
+/*!
+ * @file tracer.cpp
+ * @brief This file contains the implementation of the task tracer.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include "tbb/spin_mutex.h"
+
+#include "tracer.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// A recorded event.
+struct TraceEvent
+{
+	const char *name;
+	double start;/*!< Microseconds since the tracer was enabled. */
+	double duration;/*!< Microseconds. */
+	long arg;
+};
+
+/// Ring buffer of the events of one thread.
+struct TraceBuffer
+{
+	vector<TraceEvent> events;
+	unsigned long count;/*!< Number of recorded events (including overwritten ones). */
+	unsigned int thread;/*!< Thread number (in the order in which threads recorded their first event). */
+};
+
+bool oma::Tracer::enabled = false;
+
+/// Capacity of each ring buffer.
+static unsigned int buffer_capacity = 0;
+
+/// Time at which the tracer was enabled.
+static tick_count origin;
+
+/// Buffers of all threads.
+static vector<TraceBuffer*> buffers;
+
+/// Protects the buffer list (only needed when a thread records its first event).
+static spin_mutex buffers_lock;
+
+/// Buffer of the calling thread.
+static thread_local TraceBuffer *buffer = NULL;
+
+void oma::Tracer::enable(unsigned int capacity)
+{
+	buffer_capacity = capacity > 0 ? capacity : 1;
+	origin = tick_count::now();
+	enabled = true;
+}
+
+void oma::Tracer::record(const char *name, tick_count start, tick_count end, long arg)
+{
+	if (buffer == NULL)
+	{
+		buffer = new TraceBuffer;
+		buffer->events.resize(buffer_capacity);
+		buffer->count = 0;
+
+		spin_mutex::scoped_lock l(buffers_lock);
+		buffer->thread = buffers.size();
+		buffers.push_back(buffer);
+	}
+
+	TraceEvent &e = buffer->events[buffer->count % buffer_capacity];
+	e.name = name;
+	e.start = (start - origin).seconds() * 1e6;
+	e.duration = (end - start).seconds() * 1e6;
+	e.arg = arg;
+	buffer->count++;
+}
+
+/**
+ * Each event is written as "complete event" (phase "X"). The number of events
+ * that were overwritten is stored in the thread name metadata of each thread.
+ */
+bool oma::Tracer::write(const string &filename)
+{
+	ofstream out(filename.c_str());
+	if (!out.is_open()) return false;
+
+	spin_mutex::scoped_lock l(buffers_lock);
+
+	bool first = true;
+	out << fixed << setprecision(3) << "{\"traceEvents\": [";
+	for (unsigned int i = 0; i < buffers.size(); i++)
+	{
+		TraceBuffer *b = buffers[i];
+		unsigned long n = b->count < buffer_capacity ? b->count : buffer_capacity;
+
+		out << (first ? "" : ",") << endl << "{\"name\": \"thread_name\", \"ph\": \"M\", "
+				<< "\"pid\": 1, \"tid\": " << b->thread << ", \"args\": {\"name\": \"thread "
+				<< b->thread << "\", \"dropped_events\": " << b->count - n << "}}";
+		first = false;
+
+		for (unsigned long j = b->count - n; j < b->count; j++)
+		{
+			TraceEvent &e = b->events[j % buffer_capacity];
+			out << "," << endl << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, "
+					<< "\"tid\": " << b->thread << ", \"ts\": " << e.start << ", \"dur\": "
+					<< e.duration << ", \"args\": {\"arg\": " << e.arg << "}}";
+		}
+	}
+	out << endl << "]}" << endl;
+
+	return out.good();
+}
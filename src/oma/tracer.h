@@ -0,0 +1,90 @@
+/*!
+ * @file tracer.h
+ * @brief This file contains declarations for tracing tasks and loop chunks.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ */
+
+#ifndef TRACER_H_
+#define TRACER_H_
+
+#include <string>
+#include "tbb/tick_count.h"
+
+/// Number of events per thread that are kept by the tracer.
+#define TRACE_BUFFER_EVENTS 65536
+
+using namespace std;
+
+namespace oma
+{
+
+/// Records the execution of tasks and parallel loop chunks.
+/** Each thread records its events into its own ring buffer, so recording does
+ *  not need any locks. If a buffer is full, the oldest events are overwritten.
+ *  The events are written in the Chrome trace format (which can be viewed in
+ *  chrome://tracing or Perfetto), one track per thread. */
+class Tracer
+{
+public:
+	/// TRUE if events are recorded.
+	static bool enabled;
+
+	/// Starts recording events.
+	/** @param capacity Number of events per thread that are kept. */
+	static void enable(unsigned int capacity);
+
+	/// Records an event of the calling thread.
+	/** @param name  Name of the event. Must be a string literal (it is not copied).
+	 *  @param start Start time of the event.
+	 *  @param end   End time of the event.
+	 *  @param arg   Argument of the event (e.g. the size of a loop chunk). */
+	static void record(const char *name, tbb::tick_count start, tbb::tick_count end, long arg);
+
+	/// Writes all recorded events as Chrome trace JSON.
+	/** This must not be called while events are still being recorded.
+	 *
+	 *  @param filename The output file name.
+	 *  @return         TRUE if the file could be written. */
+	static bool write(const string &filename);
+};
+
+/// Records an event from its creation until its destruction.
+/** Does nothing (except for testing a flag) if the tracer is not enabled. */
+class TraceScope
+{
+private:
+	const char *name;
+	long arg;
+	tbb::tick_count start;
+
+	// Not copyable.
+	TraceScope(const TraceScope &s);
+	TraceScope &operator=(const TraceScope &s);
+
+public:
+	/// Starts an event.
+	/** @param n Name of the event (a string literal).
+	 *  @param a Argument of the event. */
+	TraceScope(const char *n, long a = 0) :
+			name(n), arg(a)
+	{
+		if (Tracer::enabled)
+		{
+			start = tbb::tick_count::now();
+		}
+	}
+
+	/// Ends the event.
+	~TraceScope()
+	{
+		if (Tracer::enabled)
+		{
+			Tracer::record(name, start, tbb::tick_count::now(), arg);
+		}
+	}
+};
+
+}
+
+#endif /* TRACER_H_ */
@@ -6,9 +6,14 @@
  */
 
 #include <iostream>
+#include <utility>
 
 #include "../types.h"
 #include "../methods.h"
+#include "route_store.h"
+#include "connection_scan.h"
+#include "stats.h"
+#include "search_profile.h"
 
 using namespace std;
 
@@ -16,104 +21,153 @@ using namespace std;
  * This method adds a new flight to this travel. It also ensures that the
  * minimal and maximal costs are updated:
  *
- *   * The minimal costs are always updated with the flight's costs and the
- *     highest possible discount (i.e. 30%).
  *   * The maximal costs are updated with the flight's costs and the lowest
  *     possible discount (usually 0%, except a discount applies due to a
- *     previous flight).
+ *     previous flight). The discount of the previous flight is lowered if the
+ *     new flight allows a higher discount.
+ *   * The minimal costs are derived from the maximal costs (see
+ *     "update_min_cost"). Both are updated in constant time.
  */
-void Travel::add_flight(Flight &f, Alliances *a)
+void Travel::add_flight(const Flight &f, Alliances *a)
 {
-	float discount = 1.0;
-	Flight *l = &(flights.back());
+	unsigned int discount = 100;
+	unsigned int s = size();
 
-	if (size > 0)
+	if (s > 0)
 	{
+		const Flight *l = &(last_flight());
+		unsigned int d = discounts[s - 1];
+
 		if (l->company == f.company)
 		{
-			discount = 0.7;
+			discount = 70;
 		}
 		else if (company_are_in_a_common_alliance(l->company, f.company, a))
 		{
-			discount = 0.8;
-		}
-
-		if (discount > 0.7 && discount < discounts[size - 1])
-		{
-			min_cost += floor((discount - 0.7) * l->cost);
+			discount = 80;
 		}
 
-		if (discount < 1)
+		if (discount < 100 && d > discount)
 		{
-			if (discounts[size - 1] > discount)
-			{
-				max_cost -= (discounts[size - 1] - discount) * l->cost;
-				discounts[size - 1] = discount;
-			}
+			max_cost -= discounted(l->cost, d - discount);
+			discounts[s - 1] = discount;
 		}
 	}
 
-	min_cost += f.cost * 0.7;
-	max_cost += f.cost * discount;
+	max_cost += discounted(f.cost, discount);
 
-	flights.push_back(f);
+	flights.push_back(f.index);
 	discounts.push_back(discount);
 
-	size++;
+	update_min_cost();
 }
 
-void Travel::merge_travel(Travel *t, vector<vector<string> > *a)
+void Travel::merge_travel(const Travel *t, vector<vector<string> > *a)
 {
-	Flight *l1, *f2;
-	float discount = 1.0;
+	const Flight *l1, *f2;
+	unsigned int discount = 100;
+	unsigned int s = size();
 
-	l1 = &(flights.back());
-	f2 = &(t->flights.front());
+	l1 = &(last_flight());
+	f2 = &(t->first_flight());
 
 	if (l1->company == f2->company)
 	{
-		discount = 0.7;
+		discount = 70;
 	}
 	else if (company_are_in_a_common_alliance(l1->company, f2->company, a))
 	{
-		discount = 0.8;
+		discount = 80;
 	}
 
-	flights.insert(flights.end(), t->flights.begin(), t->flights.end());
-	discounts.insert(discounts.end(), t->discounts.begin(), t->discounts.end());
+	// The flights themselves stay in the flight table, so the pointers remain
+	// valid while appending.
+	flights.append(t->flights);
+	discounts.append(t->discounts);
 
-	// Reset pointers. The insert() calls above may have triggered a reallocation,
-	// resulting in the pointers pointing to bad addresses.
-	l1 = &(flights.at(size - 1));
-	f2 = &(flights.at(size));
-
-	min_cost += t->min_cost;
 	max_cost += t->max_cost;
 
-	if (discounts[size - 1] > discount)
+	if (discounts[s - 1] > discount)
 	{
-		max_cost -= (discounts[size - 1] - discount) * l1->cost;
-		discounts[size - 1] = discount;
+		max_cost -= discounted(l1->cost, discounts[s - 1] - discount);
+		discounts[s - 1] = discount;
 	}
 
-	if (discounts[size] > discount)
+	if (discounts[s] > discount)
 	{
-		max_cost -= (discounts[size] - discount) * f2->cost;
-		discounts[size] = discount;
+		max_cost -= discounted(f2->cost, discounts[s] - discount);
+		discounts[s] = discount;
 	}
 
-	size += t->size;
+	update_min_cost();
+}
+
+/**
+ * The first and the last flight can get at most 30% discount (if the flight in
+ * front of or behind them is of the same company). The discounts of all other
+ * flights do not change anymore.
+ */
+void Travel::update_min_cost()
+{
+	unsigned int s = size();
+
+	min_cost = max_cost - discounted(first_flight().cost, discounts[0] - 70);
+	if (s > 1)
+	{
+		min_cost -= discounted(last_flight().cost, discounts[s - 1] - 70);
+	}
+}
+
+bool Travel::better_than(const Travel &t) const
+{
+	if (max_cost != t.max_cost)
+	{
+		return max_cost < t.max_cost;
+	}
+
+	unsigned int s = size(), ts = t.size();
+	if (s > 0 && ts > 0 && first_flight().take_off_time != t.first_flight().take_off_time)
+	{
+		return first_flight().take_off_time < t.first_flight().take_off_time;
+	}
+
+	// Flights are identified by their position in the flights file (which is also
+	// the order in which the reference implementation finds them).
+	for (unsigned int i = 0; i < s && i < ts; i++)
+	{
+		if (flights[i] != t.flights[i])
+		{
+			return flights[i] < t.flights[i];
+		}
+	}
+	return s < ts;
+}
+
+/**
+ * The flight and discount vectors are cleared, not freed, so that the travel
+ * can be refilled without allocating memory.
+ */
+void Travel::clear()
+{
+	flights.clear();
+	discounts.clear();
+	min_cost = 0;
+	max_cost = 0;
 }
 
 void Travel::print()
 {
 	for (unsigned int i = 0; i < flights.size(); i++)
 	{
-		cout << flights[i].id << " (" << flights[i].cost << "@" << discounts[i] << ") - ";
+		cout << flight(i).id << " (" << (double) flight(i).cost / COST_UNITS << "@"
+				<< discount(i) << "%) - ";
 	}
-	cout << max_cost << endl;
+	cout << (double) max_cost / COST_UNITS << endl;
 }
 
+vector<Flight> Travel::flight_table;
+thread_local const Flight *Travel::node_flight_table = NULL;
+
 /**
  * This constructor creates a new solution object and allocates memory for
  * *n* play hard solutions.
@@ -124,14 +178,15 @@ Solution::Solution(unsigned int s)
 }
 
 /**
- * This method adds a new travel as a "play hard" solution.
+ * This method adds a new travel as a "play hard" solution. The travel is
+ * moved, not copied.
  *
  * Concurrent access is generally possible, but should not be a problem as
  * long as every actor accesses a different index of the "play hard" array.
  */
 void Solution::add_play_hard(unsigned int i, Travel &t)
 {
-	play_hard[i] = t;
+	play_hard[i] = std::move(t);
 }
 
 /**
@@ -139,8 +194,8 @@ void Solution::add_play_hard(unsigned int i, Travel &t)
  */
 CostRange::CostRange()
 {
-	min = numeric_limits<int>::max();
-	max = numeric_limits<int>::max();
+	min = numeric_limits<Cost>::max();
+	max = numeric_limits<Cost>::max();
 }
 
 /**
@@ -153,10 +208,188 @@ void CostRange::from_travel(Travel *t)
 	lock.lock();
 	if (t->max_cost <= min)
 	{
-		// Use integers for comparison. We've had some problems with comparing
-		// float values for equality, so we round up to the next highest integer value.
-		max = (int) ceil(t->max_cost);
-		min = (int) floor(t->min_cost);
+		// Costs are fixed-point integers, so they can be compared exactly.
+		max = t->max_cost;
+		min = t->min_cost;
 	}
 	lock.unlock();
 }
+
+/**
+ * This constructor creates an empty route vector and cost range for each
+ * destination. Destinations that are named twice are stored only once.
+ */
+PathTargets::PathTargets(const vector<string> &n)
+{
+	for (unsigned int i = 0; i < n.size(); i++)
+	{
+		if (index.find(n[i]) == index.end())
+		{
+			index[n[i]] = names.size();
+			names.push_back(n[i]);
+		}
+	}
+
+	travels = new tbb::enumerable_thread_specific<oma::RouteStore>[names.size()];
+	ranges = new CostRange[names.size()];
+	max = numeric_limits<Cost>::max();
+	profile = NULL;
+	timetable = NULL;
+	forward = true;
+}
+
+PathTargets::~PathTargets()
+{
+	delete[] travels;
+	delete[] ranges;
+}
+
+int PathTargets::find(const string &city) const
+{
+	map<string, unsigned int>::const_iterator i = index.find(city);
+	return (i == index.end()) ? -1 : (int) i->second;
+}
+
+unsigned int PathTargets::size() const
+{
+	return names.size();
+}
+
+/**
+ * In a forward search, a destination can be reached from a city if the city can
+ * be left after the route arrived there. In a backward search, the city must be
+ * reachable from the destination (which is an origin then) before the route
+ * leaves it.
+ */
+void PathTargets::use_timetable(const oma::ConnectionScan *cs, bool fw, unsigned long t_min,
+		unsigned long t_max)
+{
+	timetable = cs;
+	forward = fw;
+	reach.resize(names.size());
+
+	for (unsigned int j = 0; j < names.size(); j++)
+	{
+		if (forward) cs->latest_departures(names[j], t_min, t_max, &(reach[j]));
+		else cs->earliest_arrivals(names[j], t_min, t_max, &(reach[j]));
+	}
+}
+
+Cost PathTargets::bound(const Travel *t) const
+{
+	if (timetable == NULL)
+	{
+		return max;
+	}
+
+	const Flight &f = forward ? t->last_flight() : t->first_flight();
+	return bound(forward ? f.to : f.from, forward ? f.land_time : f.take_off_time);
+}
+
+/**
+ * Costs are never negative, so a bound of -1 prunes everything.
+ */
+Cost PathTargets::bound(const string &city, unsigned long time) const
+{
+	if (timetable == NULL)
+	{
+		return max;
+	}
+
+	int c = timetable->city_index(city);
+	if (c < 0)
+	{
+		return max;
+	}
+
+	Cost b = -1;
+	for (unsigned int j = 0; j < names.size(); j++)
+	{
+		unsigned long r = reach[j][c];
+		if (forward ? r > time : r < time)
+		{
+			Cost m = ranges[j].max;
+			if (m > b) b = m;
+		}
+	}
+	return b;
+}
+
+/**
+ * This method stores a route to a destination and updates the destination's
+ * cost range and, if it decreased, the highest bound of all destinations. The
+ * cost range has its own spinlock; the route store is thread-local.
+ */
+void PathTargets::add_travel(unsigned int i, Travel *t)
+{
+	oma::RouteStore *store = &(travels[i].local());
+	oma::stats_counters().routes_emitted++;
+
+	Cost old = ranges[i].max;
+	store->push_back(*t);
+	ranges[i].from_travel(t);
+	store->set_bound(ranges[i].max);
+
+	if (ranges[i].max < old) update_max(old);
+}
+
+/**
+ * Same as "add_travel", but the route's flights are moved into the route store
+ * instead of being copied. The cost range needs to be updated first.
+ */
+void PathTargets::move_travel(unsigned int i, Travel *t)
+{
+	oma::RouteStore *store = &(travels[i].local());
+	oma::stats_counters().routes_emitted++;
+
+	Cost old = ranges[i].max;
+	ranges[i].from_travel(t);
+	store->push_back(std::move(*t));
+	store->set_bound(ranges[i].max);
+
+	if (ranges[i].max < old) update_max(old);
+}
+
+/**
+ * The highest bound can only decrease if the destination had the highest bound
+ * before, so the destinations are only rescanned in this case (and not for
+ * every found route).
+ *
+ * The bounds of the destinations only decrease. So a value that a concurrent
+ * call computed from older bounds may be too high, but never too low, and the
+ * lowest computed value is kept.
+ */
+void PathTargets::update_max(Cost old)
+{
+	Cost c = max;
+	if (old < c)
+	{
+		return;
+	}
+
+	Cost m = ranges[0].max;
+	for (unsigned int j = 1; j < names.size(); j++)
+	{
+		Cost r = ranges[j].max;
+		if (r > m) m = r;
+	}
+
+	while (m < c)
+	{
+		if (max.compare_exchange_weak(c, m))
+		{
+			if (profile != NULL) profile->bound_changed(m);
+			break;
+		}
+	}
+}
+
+void PathTargets::take_travels(unsigned int i, Travels *out)
+{
+	tbb::enumerable_thread_specific<oma::RouteStore>::iterator s;
+	for (s = travels[i].begin(); s != travels[i].end(); ++s)
+	{
+		s->set_bound(ranges[i].max);
+		s->take(out);
+	}
+}
@@ -17,10 +17,15 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
 #include <limits>
 #include <cmath>
+#include <atomic>
 
 #include "tbb/spin_mutex.h"
+#include "tbb/enumerable_thread_specific.h"
+
+#include "oma/small_vector.h"
 
 using namespace std;
 
@@ -44,8 +49,40 @@ struct Parameters
 	string work_hard_file;/*!< The file used to output the work hard result. */
 	string play_hard_file;/*!< The file used to output the play hard result. */
 	int nb_threads;/*!< The maximum number of worker threads */
+	unsigned int task_cutoff_level;/*!< Recursion level of the path search below which no more tasks are spawned. */
+	unsigned int max_hops;/*!< Maximum number of flights per partial route (0 = unlimited). */
+	unsigned int bidirectional_depth;/*!< Maximum number of flights per half search in bidirectional mode (0 = forward search only). */
+	string route_cache_file;/*!< File in which partial routes are cached between runs (empty = no cache). */
+	unsigned long memory_budget;/*!< Memory budget for found routes in MB. Routes beyond the budget are moved to temporary files (0 = unlimited). */
+	bool count_allocations;/*!< Count the heap allocations while solving the problems. */
+	string stats_file;/*!< File to which phase timings and search counters are written as JSON (empty = none). */
+	string search_profile_file;/*!< File to which the profiles of all route searches are written as JSON (empty = none). */
+	bool perf_counters;/*!< Count hardware events (cycles, instructions, ...) per phase. */
+	bool numa;/*!< Pin the search threads to NUMA nodes and replicate the flight graph on each node. */
+	string timetable_file;/*!< File to which the earliest arrivals and departure profiles of all partial routes are written (empty = none). */
+	string trace_file;/*!< File to which a trace of all tasks and loop chunks is written as Chrome trace JSON (empty = none). */
 };
 
+/// Costs are fixed-point integers with COST_UNITS units per dollar.
+/** Integer costs make all price comparisons exact (and independent of the
+ *  order in which costs are summed up). The flight costs in the input files
+ *  have many decimal places, so they are rounded to micro-dollars instead of
+ *  cents; the remaining factor 100 allows to apply percentage discounts to any
+ *  flight cost without rounding (see "discounted"). */
+typedef long Cost;
+
+/// Number of cost units per dollar.
+#define COST_UNITS 100000000L
+
+/// Applies a discount to a flight cost.
+/** @param c The flight cost.
+ *  @param d The percentage of the cost that needs to be paid (e.g. 70).
+ *  @return  The discounted cost (exact, since flight costs are multiples of 100). */
+inline Cost discounted(Cost c, unsigned int d)
+{
+	return c / 100 * d;
+}
+
 /**
  * @brief Store a single flight data.
  */
@@ -57,63 +94,132 @@ struct Flight
 	unsigned long take_off_time;/*!< Take off time (epoch). */
 	unsigned long land_time;/*!< Land time (epoch). */
 	string company;/*!< The company's name. */
-	float cost;/*!< The cost of the flight. */
-	float discout;/*!< The discount applied to the cost. */
+	Cost cost;/*!< The cost of the flight (in cost units, see COST_UNITS). */
+	unsigned int index;/*!< Index of the flight in the flight table (see "Travel::flight_table"). */
 };
 
 // Yes, we are lazy and don't want to type "vector<vector<string> >" too often... ;)
 typedef vector<vector<string> > Alliances;
 
+/// Number of flights that a travel stores without allocating memory.
+#define TRAVEL_INLINE_FLIGHTS 6
+
 /// Models a travel and associated application logic.
+/** A travel does not store copies of its flights, but only their indices in
+ *  the flight table, and its discounts as percentages. Up to
+ *  TRAVEL_INLINE_FLIGHTS flights are stored inline, which makes a travel
+ *  64 bytes large. Copying such a travel does not allocate memory. */
 class Travel
 {
 public:
-	/// Flights contained in this travel.
+	/// All flights, indexed by their line in the flights file.
+	static vector<Flight> flight_table;
+
+	/// The copy of the flight table of the calling thread's NUMA node.
+	/** NULL if the thread does not run in the arena of a NUMA node with its own
+	 *  copy (see "oma::init_numa_nodes"). Then, "flight_table" is used. */
+	static thread_local const Flight *node_flight_table;
+
+	/// Gets a flight of the flight table.
+	/** The copy of the calling thread's NUMA node is used if there is one.
+	 *
+	 *  @param i The index of the flight. */
+	static const Flight &table_flight(unsigned int i)
+	{
+		return node_flight_table != NULL ? node_flight_table[i] : flight_table[i];
+	}
+
+	/// Flights contained in this travel (indices in the flight table).
 	/** A travel is (not anymore!) just a list of Flight(s). */
-	vector<Flight> flights;
+	oma::SmallVector<unsigned int, TRAVEL_INLINE_FLIGHTS> flights;
 
-	/// Discounts applied to each flight.
+	/// Discounts applied to each flight (in percent of the flight costs).
 	/** Discounts applied to each flight. Due to parallel processing,
 	 *  we cannot store the discount directly in the Flight objects. */
-	vector<float> discounts;
-
-	/// Total costs of this travel.
-	/** The total cost of this travel. This is the sum of flight costs
-	 *  minus all possible discounts. The actual total costs of a travel
-	 *  can only be computed, when it is guaranteed that no flights are
-	 *  added any more (otherwise the costs can change due to discounts). */
-	float total_cost;
+	oma::SmallVector<unsigned char, TRAVEL_INLINE_FLIGHTS> discounts;
 
 	/// Minimal costs of this travel.
-	/** The minimal costs is the sum of all travel costs with highest
-	 *  possible discount. */
-	float min_cost;
+	/** The discount of a flight only depends on its neighbours, so the discounts
+	 *  of all inner flights of a travel are final. Only the first and the last
+	 *  flight can still get a higher discount from a flight that is added in
+	 *  front of or behind the travel. The minimal costs are the (exact) costs of
+	 *  the travel if both of these flights get the highest possible discount. */
+	Cost min_cost;
 
 	/// Maximal costs of this travel.
 	/** The maximal costs is the sum of this travel (i.e. all travel costs
-	 *  with lowest possible discount). */
-	float max_cost;
-
-	/// Helper storing the size of the travel.
-	int size;
+	 *  with lowest possible discount). The actual total costs of a travel
+	 *  can only be computed, when it is guaranteed that no flights are
+	 *  added any more (otherwise the costs can change due to discounts). */
+	Cost max_cost;
 
 	/// Creates a new travel.
 	Travel() :
-			total_cost(0), min_cost(0), max_cost(0), size(0)
+			min_cost(0), max_cost(0)
+	{
+	}
+
+	/// Gets the number of flights of this travel.
+	unsigned int size() const
+	{
+		return flights.size();
+	}
+
+	/// Gets a flight of this travel.
+	/** @param i The position of the flight in this travel. */
+	const Flight &flight(unsigned int i) const
+	{
+		return table_flight(flights[i]);
+	}
+
+	/// Gets the first flight of this travel.
+	const Flight &first_flight() const
+	{
+		return table_flight(flights.front());
+	}
+
+	/// Gets the last flight of this travel.
+	const Flight &last_flight() const
+	{
+		return table_flight(flights.back());
+	}
+
+	/// Gets the discount applied to a flight of this travel.
+	/** @param i The position of the flight in this travel.
+	 *  @return  The percentage of the flight's costs that needs to be paid (e.g. 70). */
+	unsigned int discount(unsigned int i) const
 	{
+		return discounts[i];
 	}
 
 	/// Adds a new flight to this travel.
 	/** @param f The flight to be added.
 	 *  @param a A list of allicances. Is needed, because this function takes discouts
 	 *           into account. */
-	void add_flight(Flight &f, Alliances *a);
+	void add_flight(const Flight &f, Alliances *a);
 
 	/// Merges two travels into one.
 	/** @param t The travel to be merged.
 	 *  @param a The list of allicances. Is needed, because this function takes discouts
 	 *           into account. */
-	void merge_travel(Travel *t, Alliances *a);
+	void merge_travel(const Travel *t, Alliances *a);
+
+	/// Removes all flights from this travel (but keeps the allocated memory).
+	void clear();
+
+	/// Computes the minimal costs from the maximal costs and the end flights.
+	void update_min_cost();
+
+	/// Tests if this travel is better than another travel.
+	/** Travels are ordered by their (maximal) costs, then by the take off time of
+	 *  their first flight, then by their flights (i.e. the flights' positions in the
+	 *  flights file). This is a total order, so the cheapest of a set of travels
+	 *  does not depend on the order in which the travels are compared (and thus
+	 *  not on the number of threads).
+	 *
+	 *  @param t The other travel.
+	 *  @return  TRUE if this travel comes first. */
+	bool better_than(const Travel &t) const;
 
 	/// Prints a textual representation of this travel to STDOUT.
 	void print();
@@ -121,6 +227,9 @@ public:
 
 typedef vector<Travel> Travels;
 
+/// Partial routes, grouped by the city in which they end (or begin).
+typedef map<string, Travels> RoutesByCity;
+
 /// Models a location and associated application logic.
 /** This class models a single location (i.e. a possible flight origin
  *  or destination). In our flight graph, the locations are nodes, flights
@@ -161,7 +270,8 @@ public:
 
 	/// Adds a new "play hard" solution.
 	/** @param i The index of the "play hard" solution.
-	 *  @param t The travel to be added as the solution. */
+	 *  @param t The travel to be added as the solution. It is moved into the
+	 *           solution, so it is empty afterwards. */
 	void add_play_hard(unsigned int i, Travel &t);
 };
 
@@ -177,9 +287,10 @@ private:
 	tbb::spin_mutex lock;
 public:
 	/// Minimum price.
-	int min;
+	Cost min;
 	/// Maximum price.
-	int max;
+	/** Only written under the lock, but it may be read at any time. */
+	std::atomic<Cost> max;
 
 	/// Creates a new price range.
 	CostRange();
@@ -190,4 +301,130 @@ public:
 
 };
 
+namespace oma
+{
+class RouteStore;
+class SearchProfile;
+class ConnectionScan;
+}
+
+/// Models the destinations of a route search.
+/** A route search can look for routes to several destinations at once (e.g.
+ *  from home to ALL vacation destinations). The found routes and the cost range
+ *  of the cheapest route are stored separately for each destination, so that each
+ *  destination can be filtered against its own cost bound afterwards.
+ *
+ *  A route that is more expensive than the highest bound of all destinations
+ *  cannot be of any use anymore. This bound is available as "max". With a
+ *  timetable (see "use_timetable"), only the bounds of the destinations that the
+ *  route can still reach count (see "bound"). So a destination without any route
+ *  yet does not turn off the pruning for routes that cannot reach it anyway. */
+class PathTargets
+{
+private:
+	/// Maps destination names to destination indices.
+	map<string, unsigned int> index;
+
+	/// Found routes for each destination (one store per destination and thread).
+	tbb::enumerable_thread_specific<oma::RouteStore> *travels;
+
+	// Not copyable (the route stores and cost ranges are not, either).
+	PathTargets(const PathTargets &t);
+	PathTargets &operator=(const PathTargets &t);
+
+	/// Timetable for the reachability of the destinations (NULL = none).
+	const oma::ConnectionScan *timetable;
+
+	/// TRUE if the routes grow forward (towards the destinations).
+	bool forward;
+
+	/// For each destination, when each city must be left (forward search) or
+	/// reached (backward search) at the latest or earliest to still connect it.
+	/** Indexed by destination and city (see "ConnectionScan::city_index"). */
+	vector<vector<unsigned long> > reach;
+
+	/// Updates the highest maximum price after a destination's price decreased.
+	/** @param old The destination's maximum price before. */
+	void update_max(Cost old);
+
+public:
+	/// Destination names. Duplicates are stored only once.
+	vector<string> names;
+
+	/// Cost ranges for each destination.
+	CostRange *ranges;
+
+	/// Highest maximum price of all destinations.
+	std::atomic<Cost> max;
+
+	/// Profile of the search (NULL if the search is not profiled).
+	oma::SearchProfile *profile;
+
+	/// Creates a new set of destinations.
+	/** @param n The destination names. */
+	PathTargets(const vector<string> &n);
+
+	/// Destroys the set of destinations.
+	~PathTargets();
+
+	/// Looks up a destination.
+	/** @param city The city name.
+	 *  @return     The index of the destination, or -1 if the city is no destination. */
+	int find(const string &city) const;
+
+	/// Gets the number of destinations.
+	unsigned int size() const;
+
+	/// Uses a timetable to find the destinations that a route can still reach.
+	/** Must be called before the search starts.
+	 *
+	 *  @param cs    The timetable.
+	 *  @param fw    TRUE for a forward search, FALSE for a backward search.
+	 *  @param t_min You must not be in a plane before this value (epoch).
+	 *  @param t_max You must not be in a plane after this value (epoch). */
+	void use_timetable(const oma::ConnectionScan *cs, bool fw, unsigned long t_min,
+			unsigned long t_max);
+
+	/// Gets the cost bound for a route.
+	/** This is the highest maximum price of all destinations that the route can
+	 *  still reach. The route and all routes that extend it are of no use if they
+	 *  are more expensive.
+	 *
+	 *  @param t The route.
+	 *  @return  The bound (-1 if no destination can be reached anymore). */
+	Cost bound(const Travel *t) const;
+
+	/// Gets the cost bound for a route that ends at a city.
+	/** @param city The city at the open end of the route.
+	 *  @param time The land time of its last flight (forward search) or the take
+	 *              off time of its first flight (backward search).
+	 *  @return     The bound (-1 if no destination can be reached anymore).
+	 *  @see bound(const Travel*) */
+	Cost bound(const string &city, unsigned long time) const;
+
+	/// Adds a found route to a destination.
+	/** The route is stored in the calling thread's own route store, so no lock is
+	 *  needed. Routes of the destination that have become too expensive are evicted.
+	 *
+	 *  @param i The index of the destination.
+	 *  @param t The route. */
+	void add_travel(unsigned int i, Travel *t);
+
+	/// Moves a found route into a destination.
+	/** Use this instead of "add_travel" if the route is not needed anymore
+	 *  afterwards, since this saves copying its flights.
+	 *
+	 *  @param i The index of the destination.
+	 *  @param t The route. It is empty afterwards. */
+	void move_travel(unsigned int i, Travel *t);
+
+	/// Moves all routes of a destination that fit its cost range into a vector.
+	/** The route stores of all threads are concatenated. This must not be called
+	 *  while routes are still being added.
+	 *
+	 *  @param i   The index of the destination.
+	 *  @param out Output vector. */
+	void take_travels(unsigned int i, Travels *out);
+};
+
 #endif /* TYPES_H_ */
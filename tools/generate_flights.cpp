@@ -0,0 +1,284 @@
+/*!
+ * @file generate_flights.cpp
+ * @brief This file contains a generator for synthetic flight and alliance files.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ *
+ * The generator writes a scenario directory containing
+ *
+ *   * flights.txt   (id;from;take off;to;land;cost;company),
+ *   * alliances.txt (one alliance per line, companies separated by ";") and
+ *   * script.sh     (a query that fits the generated data).
+ *
+ * The cities are named C1 ... Cn. The cities of each flight are drawn from a
+ * power-law distribution (the probability of city i is proportional to
+ * 1 / i^skew), so that low-numbered cities are hubs. The output only depends on
+ * the parameters and the seed (random numbers are derived from the raw output
+ * of a Mersenne twister, whose sequence is the same on all platforms).
+ *
+ * Usage: generate_flights -out <dir> [-cities n] [-days n] [-flights_per_day n]
+ *            [-airlines n] [-alliances n] [-alliance_density p] [-hub_skew s]
+ *            [-seed n]
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <time.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/// Parameters of the generator.
+struct GeneratorParameters
+{
+	string out;/*!< Output directory. */
+	unsigned int cities;/*!< Number of cities. */
+	unsigned int days;/*!< Number of days covered by the flights. */
+	unsigned long flights_per_day;/*!< Number of flights per day. */
+	unsigned int airlines;/*!< Number of airlines. */
+	unsigned int alliances;/*!< Number of alliances. */
+	double alliance_density;/*!< Probability of an airline to be member of an alliance. */
+	double hub_skew;/*!< Exponent of the power-law distribution of the cities (0 = uniform). */
+	unsigned long seed;/*!< Seed of the random number generator. */
+};
+
+/// First day of the generated flights (Jan 1st 2013, 00:00 UTC).
+#define START_TIME 1356998400L
+
+/// Random number generator with platform-independent results.
+class Random
+{
+private:
+	mt19937_64 engine;
+
+public:
+	/// Creates a new generator.
+	/** @param seed The seed. */
+	Random(unsigned long seed) :
+			engine(seed)
+	{
+	}
+
+	/// Gets a uniformly distributed number in [0, 1).
+	double uniform()
+	{
+		return (engine() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	/// Gets a uniformly distributed integer in [0, n).
+	unsigned long below(unsigned long n)
+	{
+		return (unsigned long) (uniform() * n);
+	}
+};
+
+/// Draws cities from a power-law distribution.
+class CityDistribution
+{
+private:
+	/// Cumulative probabilities of the cities.
+	vector<double> cumulative;
+
+public:
+	/// Creates a new distribution.
+	/** @param n    Number of cities.
+	 *  @param skew Exponent of the power law. */
+	CityDistribution(unsigned int n, double skew)
+	{
+		double sum = 0;
+		for (unsigned int i = 1; i <= n; i++)
+		{
+			sum += 1.0 / pow(i, skew);
+			cumulative.push_back(sum);
+		}
+		for (unsigned int i = 0; i < n; i++)
+		{
+			cumulative[i] /= sum;
+		}
+	}
+
+	/// Draws a city.
+	/** @return The index of the city (0 is the largest hub). */
+	unsigned int draw(Random &r) const
+	{
+		unsigned int i = lower_bound(cumulative.begin(), cumulative.end(), r.uniform())
+				- cumulative.begin();
+		return min(i, (unsigned int) cumulative.size() - 1);
+	}
+};
+
+/// Formats a time in the format of the flights file (MMDDYYYYHHMMSS).
+/** @param t   The time (epoch).
+ *  @param buf Output buffer (at least 16 characters). */
+void format_time(long t, char *buf)
+{
+	time_t tt = t;
+	struct tm tm;
+	gmtime_r(&tt, &tm);
+	strftime(buf, 16, "%m%d%Y%H%M%S", &tm);
+}
+
+/// Reads the generator parameters.
+/** @param p    Output parameters.
+ *  @param argc Count of command line parameters.
+ *  @param argv Command line parameters.
+ *  @return     FALSE if the parameters are invalid. */
+bool read_parameters(GeneratorParameters &p, int argc, char **argv)
+{
+	p.out = "";
+	p.cities = 100;
+	p.days = 30;
+	p.flights_per_day = 1000;
+	p.airlines = 20;
+	p.alliances = 4;
+	p.alliance_density = 0.5;
+	p.hub_skew = 1.0;
+	p.seed = 1;
+
+	for (int i = 1; i < argc - 1; i++)
+	{
+		string current_parameter = argv[i];
+		if (current_parameter == "-out") p.out = argv[++i];
+		else if (current_parameter == "-cities") p.cities = atoi(argv[++i]);
+		else if (current_parameter == "-days") p.days = atoi(argv[++i]);
+		else if (current_parameter == "-flights_per_day") p.flights_per_day = atol(argv[++i]);
+		else if (current_parameter == "-airlines") p.airlines = atoi(argv[++i]);
+		else if (current_parameter == "-alliances") p.alliances = atoi(argv[++i]);
+		else if (current_parameter == "-alliance_density") p.alliance_density = atof(argv[++i]);
+		else if (current_parameter == "-hub_skew") p.hub_skew = atof(argv[++i]);
+		else if (current_parameter == "-seed") p.seed = atol(argv[++i]);
+	}
+
+	if (p.out == "" || p.cities < 8 || p.days < 10 || p.airlines < 1)
+	{
+		cerr << "Usage: " << argv[0] << " -out <dir> [-cities n (>= 8)] [-days n (>= 10)]"
+				<< " [-flights_per_day n] [-airlines n] [-alliances n]"
+				<< " [-alliance_density p] [-hub_skew s] [-seed n]" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+/// Writes the alliances file.
+/** Each airline joins a randomly chosen alliance with probability
+ *  "alliance_density". Alliances with less than two members are omitted. */
+bool write_alliances(const GeneratorParameters &p, Random &r)
+{
+	vector<vector<unsigned int> > members(p.alliances);
+	for (unsigned int i = 0; i < p.airlines && p.alliances > 0; i++)
+	{
+		if (r.uniform() < p.alliance_density)
+		{
+			members[r.below(p.alliances)].push_back(i);
+		}
+	}
+
+	FILE *f = fopen((p.out + "/alliances.txt").c_str(), "w");
+	if (f == NULL) return false;
+
+	for (unsigned int i = 0; i < members.size(); i++)
+	{
+		if (members[i].size() < 2) continue;
+		for (unsigned int j = 0; j < members[i].size(); j++)
+		{
+			fprintf(f, "%sAirline %u", j > 0 ? ";" : "", members[i][j] + 1);
+		}
+		fprintf(f, "\n");
+	}
+
+	return fclose(f) == 0;
+}
+
+/// Writes the flights file.
+/** The flights are written day by day (using stdio, since the files may have
+ *  millions of lines). Flights take 1 to 12 hours, and their costs depend on
+ *  their duration. */
+bool write_flights(const GeneratorParameters &p, Random &r)
+{
+	CityDistribution cities(p.cities, p.hub_skew);
+	char take_off[16], land[16];
+	unsigned long id = 1;
+
+	FILE *f = fopen((p.out + "/flights.txt").c_str(), "w");
+	if (f == NULL) return false;
+
+	for (unsigned int d = 0; d < p.days; d++)
+	{
+		for (unsigned long i = 0; i < p.flights_per_day; i++)
+		{
+			unsigned int from = cities.draw(r), to = cities.draw(r);
+			while (to == from)
+			{
+				to = cities.draw(r);
+			}
+
+			long t = START_TIME + d * 86400L + r.below(86400 / 60) * 60;
+			long duration = 3600 + r.below(11 * 60) * 60;
+			double cost = (50 + 100 * r.uniform()) * duration / 3600.0;
+
+			format_time(t, take_off);
+			format_time(t + duration, land);
+			fprintf(f, "%lu;C%u;%s;C%u;%s;%.2f;Airline %lu\n", id++, from + 1, take_off, to + 1,
+					land, cost, r.below(p.airlines) + 1);
+		}
+	}
+
+	return fclose(f) == 0;
+}
+
+/// Writes a script that runs the solver on the generated data.
+/** The conference takes place in the second largest hub, home is the largest
+ *  hub and the next five hubs are the vacation destinations. */
+bool write_script(const GeneratorParameters &p)
+{
+	char dep_min[16], dep_max[16], ar_min[16], ar_max[16];
+	format_time(START_TIME + 1 * 86400L, dep_min);
+	format_time(START_TIME + 3 * 86400L, dep_max);
+	format_time(START_TIME + 8 * 86400L, ar_min);
+	format_time(START_TIME + 10 * 86400L, ar_max);
+
+	string filename = p.out + "/script.sh";
+	FILE *f = fopen(filename.c_str(), "w");
+	if (f == NULL) return false;
+
+	fprintf(f, "#!/bin/bash\n\n../../run -nb_threads 4 -from C1 -to C2"
+			" -departure_time_min %s -departure_time_max %s -arrival_time_min %s"
+			" -arrival_time_max %s -max_layover 14400 -vacation_time_min 86400"
+			" -vacation_time_max 259200 -flights flights.txt -alliances alliances.txt"
+			" -work_hard_file work_hard.txt -play_hard_file play_hard.txt"
+			" -vacation_airports C3 C4 C5 C6 C7\n", dep_min, dep_max, ar_min, ar_max);
+
+	if (fclose(f) != 0) return false;
+	return chmod(filename.c_str(), 0755) == 0;
+}
+
+int main(int argc, char **argv)
+{
+	GeneratorParameters p;
+	if (!read_parameters(p, argc, argv))
+	{
+		return 1;
+	}
+
+	mkdir(p.out.c_str(), 0755);
+
+	// Alliances and flights use separate generators, so that the flights do not
+	// change when only the alliance parameters do.
+	Random alliance_random(p.seed), flight_random(p.seed + 1);
+
+	if (!write_alliances(p, alliance_random) || !write_flights(p, flight_random)
+			|| !write_script(p))
+	{
+		cerr << "Could not write to " << p.out << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+/*!
+ * @file microbench.cpp
+ * @brief This file contains microbenchmarks for the hot functions of the solver.
+ * @author Martin Helmich <martin.helmich@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ * @author Oliver Erxleben <oliver.erxleben@hs-osnabrueck.de>, University of Applied Sciences Osnabrück
+ *
+ * Each benchmark runs a function on real data from a scenario (all flights of
+ * the flights file) and reports the median time per call over several samples.
+ * This allows to check whether a change of one of these functions is a win in
+ * isolation, independent of the noise of whole runs.
+ *
+ * The program is linked with the object files of the solver (see "make tools").
+ *
+ * Usage: microbench [-flights file] [-alliances file] [-max_layover seconds]
+ *            [-samples n] [-filter name]
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <functional>
+
+#include "tbb/tick_count.h"
+#include "tbb/task_group.h"
+#include "tbb/concurrent_hash_map.h"
+
+#include "types.h"
+#include "methods.h"
+#include "oma/tasks.h"
+#include "oma/route_store.h"
+
+using namespace std;
+using namespace tbb;
+using namespace oma;
+
+/// The flight graph of the solver (see main.cpp).
+extern concurrent_hash_map<string, Location> *location_map;
+
+/// Minimal duration of a sample (in seconds).
+#define MIN_SAMPLE_TIME 0.05
+
+/// Parameters of the microbenchmarks.
+struct BenchParameters
+{
+	string flights_file;/*!< The file containing the flights. */
+	string alliances_file;/*!< The file containing the alliances. */
+	unsigned long max_layover_time;/*!< Maximum layover time for route extensions. */
+	unsigned int samples;/*!< Number of samples per benchmark. */
+	string filter;/*!< Only run benchmarks whose name contains this string. */
+};
+
+/// Runs a benchmark and prints the time per call.
+/** The body is run repeatedly, so that each sample takes at least
+ *  MIN_SAMPLE_TIME seconds. Before each run, the (optional) reset function is
+ *  called; its time is not measured.
+ *
+ *  @param p     The benchmark parameters.
+ *  @param name  The benchmark name.
+ *  @param calls Number of calls of the benchmarked function per run of the body.
+ *  @param body  The benchmark body.
+ *  @param reset Restores the state before a run of the body. */
+void run_benchmark(BenchParameters &p, const string &name, unsigned long calls,
+		const function<void()> &body, const function<void()> &reset = function<void()>())
+{
+	if (name.find(p.filter) == string::npos || calls == 0)
+	{
+		return;
+	}
+
+	vector<double> times;
+	unsigned long runs = 0;
+	for (unsigned int s = 0; s < p.samples; s++)
+	{
+		double elapsed = 0;
+		unsigned long n = 0;
+		while (elapsed < MIN_SAMPLE_TIME)
+		{
+			if (reset) reset();
+
+			tick_count t0 = tick_count::now();
+			body();
+			elapsed += (tick_count::now() - t0).seconds();
+			n++;
+		}
+		runs += n;
+		times.push_back(elapsed * 1e9 / (n * calls));
+	}
+
+	sort(times.begin(), times.end());
+	printf("%-36s %14lu %12.1f %12.1f %12.1f\n", name.c_str(), runs * calls,
+			times[times.size() / 2], times.front(), times.back());
+}
+
+/// Reads all lines of a file.
+/** @param filename The file name.
+ *  @param lines    Output lines (empty lines are skipped). */
+bool read_lines(const string &filename, vector<string> &lines)
+{
+	ifstream file(filename.c_str());
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	string line;
+	while (getline(file, line))
+	{
+		if (line.size() > 0) lines.push_back(line);
+	}
+	return true;
+}
+
+/// Reads the benchmark parameters.
+void read_parameters(BenchParameters &p, int argc, char **argv)
+{
+	p.flights_file = "scenarios/scenario10/flights.txt";
+	p.alliances_file = "scenarios/scenario10/alliances.txt";
+	p.max_layover_time = 14400;
+	p.samples = 5;
+	p.filter = "";
+
+	for (int i = 1; i < argc - 1; i++)
+	{
+		string current_parameter = argv[i];
+		if (current_parameter == "-flights") p.flights_file = argv[++i];
+		else if (current_parameter == "-alliances") p.alliances_file = argv[++i];
+		else if (current_parameter == "-max_layover") p.max_layover_time = atol(argv[++i]);
+		else if (current_parameter == "-samples") p.samples = max(1, atoi(argv[++i]));
+		else if (current_parameter == "-filter") p.filter = argv[++i];
+	}
+}
+
+int main(int argc, char **argv)
+{
+	BenchParameters bp;
+	read_parameters(bp, argc, argv);
+
+	vector<string> lines;
+	if (!read_lines(bp.flights_file, lines))
+	{
+		cerr << "Could not read " << bp.flights_file << endl;
+		return 1;
+	}
+
+	// The solver's parameters only need to keep all flights and allow long layovers.
+	Parameters parameters;
+	parameters.dep_time_min = 0;
+	parameters.vacation_time_max = 0;
+	parameters.ar_time_max = numeric_limits<long>::max();
+	parameters.max_layover_time = bp.max_layover_time;
+	parameters.max_hops = 0;
+	parameters.task_cutoff_level = 0;
+
+	Alliances alliances;
+	parse_alliances(&alliances, bp.alliances_file);
+
+	location_map = new concurrent_hash_map<string, Location>;
+	Travel::flight_table.resize(lines.size());
+
+	// Copies of the lines, since parsing modifies them.
+	vector<char> buffer;
+	vector<unsigned int> offsets;
+	for (unsigned int i = 0; i < lines.size(); i++)
+	{
+		offsets.push_back(buffer.size());
+		buffer.insert(buffer.end(), lines[i].begin(), lines[i].end());
+		buffer.push_back(0);
+	}
+	vector<char> work(buffer.size());
+
+	printf("%-36s %14s %12s %12s %12s\n", "benchmark", "calls", "median ns", "min ns",
+			"max ns");
+
+	run_benchmark(bp, "parse_flight", lines.size(), [&]()
+	{
+		for (unsigned int i = 0; i < offsets.size(); i++)
+		{
+			parse_flight(&(work[offsets[i]]), i, &parameters);
+		}
+	}, [&]()
+	{
+		location_map->clear();
+		memcpy(&(work[0]), &(buffer[0]), buffer.size());
+	});
+
+	// Set up the flight graph for the other benchmarks.
+	location_map->clear();
+	memcpy(&(work[0]), &(buffer[0]), buffer.size());
+	vector<Flight*> flights;
+	for (unsigned int i = 0; i < offsets.size(); i++)
+	{
+		parse_flight(&(work[offsets[i]]), i, &parameters);
+		if (Travel::flight_table[i].from != "") flights.push_back(&(Travel::flight_table[i]));
+	}
+
+	// The take off times of all flights (as in the flights file).
+	vector<string> timestamps;
+	for (unsigned int i = 0; i < lines.size(); i++)
+	{
+		vector<string> fields;
+		split_string(fields, lines[i], ';');
+		if (fields.size() >= 3) timestamps.push_back(fields[2]);
+	}
+
+	time_t sum = 0;
+	run_benchmark(bp, "convert_string_to_timestamp", timestamps.size(), [&]()
+	{
+		for (unsigned int i = 0; i < timestamps.size(); i++)
+		{
+			sum += convert_string_to_timestamp((char*) timestamps[i].c_str());
+		}
+	});
+
+	// Companies of consecutive flights (the alliance lookup is cached, as in the solver).
+	unsigned int n = flights.size();
+	unsigned int common = 0;
+	run_benchmark(bp, "company_are_in_a_common_alliance", n, [&]()
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			common += company_are_in_a_common_alliance(flights[i]->company,
+					flights[(i + 1) % n]->company, &alliances);
+		}
+	});
+
+	// Routes of up to four flights, built from consecutive flights of the file.
+	Travel t;
+	run_benchmark(bp, "Travel::add_flight", n, [&]()
+	{
+		for (unsigned int i = 0; i < n; i++)
+		{
+			if (t.size() == 4) t.clear();
+			t.add_flight(*flights[i], &alliances);
+		}
+	});
+
+	vector<Travel> pairs(n / 2);
+	for (unsigned int i = 0; i + 1 < n; i += 2)
+	{
+		pairs[i / 2].add_flight(*flights[i], &alliances);
+		pairs[i / 2].add_flight(*flights[i + 1], &alliances);
+	}
+
+	Travel merged;
+	run_benchmark(bp, "Travel::merge_travel (with copy)", pairs.size() - 1, [&]()
+	{
+		for (unsigned int i = 0; i + 1 < pairs.size(); i++)
+		{
+			merged = pairs[i];
+			merged.merge_travel(&(pairs[i + 1]), &alliances);
+		}
+	});
+
+	vector<Travel> quads(pairs.size() / 2);
+	for (unsigned int i = 0; i < quads.size(); i++)
+	{
+		quads[i] = pairs[2 * i];
+		quads[i].merge_travel(&(pairs[2 * i + 1]), &alliances);
+	}
+
+	unsigned int unvisited = 0;
+	run_benchmark(bp, "nerver_traveled_to (4 flights)", quads.size(), [&]()
+	{
+		for (unsigned int i = 0; i < quads.size(); i++)
+		{
+			unvisited += nerver_traveled_to(quads[i], flights[i]->to);
+		}
+	});
+
+	// One expansion step: all follow-up flights of a one-flight route are tested
+	// and the feasible ones are added. The search does not go deeper, since the
+	// routes are limited to two flights. No route reaches the (unknown) target.
+	vector<Travel> starts(min(n, 1000u));
+	for (unsigned int i = 0; i < starts.size(); i++)
+	{
+		starts[i].add_flight(*flights[i * (n / starts.size())], &alliances);
+	}
+
+	vector<string> target_names(1, "");
+	PathTargets targets(target_names);
+	task_group group;
+	parameters.max_hops = 2;
+	run_benchmark(bp, "ComputePathTask expansion step", starts.size(), [&]()
+	{
+		for (unsigned int i = 0; i < starts.size(); i++)
+		{
+			ComputePathTask(&(starts[i]), &targets, true, 0, numeric_limits<long>::max(),
+					&parameters, &alliances, location_map, &group, 0)();
+		}
+	});
+	group.wait();
+
+	// Print the results, so that the compiler cannot drop the benchmarked calls.
+	cerr << "(checksum " << sum + common + unvisited << ")" << endl;
+
+	return 0;
+}